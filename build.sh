@@ -1 +1,8 @@
-g++ -std=c++17 know-it-all.cpp -lstdc++fs -o kial
+# usage: ./build.sh [kial|kial-bench|all]
+target=${1:-kial}
+if [ "$target" = "kial" ] || [ "$target" = "all" ]; then
+    g++ -std=c++17 -O2 know-it-all.cpp -lstdc++fs -pthread -o kial
+fi
+if [ "$target" = "kial-bench" ] || [ "$target" = "all" ]; then
+    g++ -std=c++17 -O2 kial-bench.cpp -lstdc++fs -pthread -o kial-bench
+fi
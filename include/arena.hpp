@@ -0,0 +1,96 @@
+// https://github.com/jibstack64/know-it-all
+// a swappable, per-thread memory resource and a stateless allocator that draws from it, all in one header file!
+// made for containers (like nlohmann's basic_json) that default-construct their allocators and so cannot carry one.
+
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace arena {
+
+    // the resource every arena::allocator on this thread currently draws from. the global heap unless a scope says otherwise.
+    inline std::pmr::memory_resource *& current() {
+        static thread_local std::pmr::memory_resource * resource = std::pmr::new_delete_resource();
+        return resource;
+    }
+
+    // a stateless allocator over current(). each block carries the resource that handed it out
+    // just in front of it, so it is given back to that resource whichever is current when it is freed.
+    template<typename T>
+    struct allocator {
+        using value_type = T;
+
+        // room for the owning resource, rounded up so the block after it stays aligned for T
+        static constexpr std::size_t align = alignof(T) > alignof(std::pmr::memory_resource *) ? alignof(T) : alignof(std::pmr::memory_resource *);
+        static constexpr std::size_t header = (sizeof(std::pmr::memory_resource *) + align - 1) / align * align;
+
+        allocator() = default;
+
+        template<typename U>
+        allocator(const allocator<U>&) {}
+
+        T * allocate(std::size_t n) {
+            std::pmr::memory_resource * owner = current();
+            char * base = static_cast<char *>(owner->allocate(header + n * sizeof(T), align));
+            reinterpret_cast<std::pmr::memory_resource **>(base + header)[-1] = owner;
+            return reinterpret_cast<T *>(base + header);
+        }
+
+        void deallocate(T * p, std::size_t n) {
+            char * base = reinterpret_cast<char *>(p) - header;
+            std::pmr::memory_resource * owner = reinterpret_cast<std::pmr::memory_resource **>(p)[-1];
+            owner->deallocate(base, header + n * sizeof(T), align);
+        }
+
+        template<typename U>
+        bool operator==(const allocator<U>&) const {
+            return true;
+        }
+
+        template<typename U>
+        bool operator!=(const allocator<U>&) const {
+            return false;
+        }
+    };
+
+    // routes every arena::allocator on this thread to 'resource' for as long as it lives.
+    class scope {
+        private:
+            std::pmr::memory_resource * previous;
+
+        public:
+            scope(std::pmr::memory_resource * resource) : previous(current()) {
+                current() = resource;
+            }
+
+            ~scope() {
+                current() = previous;
+            }
+
+            scope(const scope&) = delete;
+            scope& operator=(const scope&) = delete;
+    };
+
+    // a monotonic arena: allocating is a pointer bump, freeing does nothing, and
+    // everything is handed back to the heap in a few large blocks when it is destroyed.
+    // not thread-safe; only the thread that made it allocates from it.
+    class monotonic {
+        private:
+            std::pmr::monotonic_buffer_resource buffer;
+            scope active;
+
+        public:
+            monotonic(std::size_t initial = 1 << 20) : buffer(initial, std::pmr::new_delete_resource()), active(&buffer) {}
+    };
+
+    // the plain heap, for allocations that are freed again well before the arena would be,
+    // such as items that are parsed, looked at and thrown away one at a time.
+    class heap {
+        private:
+            scope active {std::pmr::new_delete_resource()};
+    };
+}
+
+#endif
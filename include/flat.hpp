@@ -0,0 +1,203 @@
+// https://github.com/jibstack64/know-it-all
+// a map kept as one sorted, contiguous vector of pairs, all in one header file!
+// made to stand in for std::map as nlohmann's basic_json object type, where objects are small
+// and looked up far more often than they change, so a binary search over adjacent memory beats a tree walk.
+
+#ifndef FLAT_HPP
+#define FLAT_HPP
+
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace flat {
+
+    // a sorted vector of key/value pairs, with std::map's interface where basic_json uses it.
+    // keys are not const within the pairs (so that the vector can shift them), but must not be changed
+    // through an iterator. inserting and erasing move every pair after the one inserted or erased.
+    // the vector is a private base, so nothing outside can put the pairs out of order.
+    template<class Key, class T, class Compare = std::less<>, class Allocator = std::allocator<std::pair<const Key, T>>>
+    class map : private std::vector<std::pair<Key, T>, typename std::allocator_traits<Allocator>::template rebind_alloc<std::pair<Key, T>>> {
+        public:
+            using key_type = Key;
+            using mapped_type = T;
+            using key_compare = Compare;
+            using Container = std::vector<std::pair<Key, T>, typename std::allocator_traits<Allocator>::template rebind_alloc<std::pair<Key, T>>>;
+            using iterator = typename Container::iterator;
+            using const_iterator = typename Container::const_iterator;
+            using size_type = typename Container::size_type;
+            using value_type = typename Container::value_type;
+            using difference_type = typename Container::difference_type;
+            using reference = typename Container::reference;
+            using const_reference = typename Container::const_reference;
+            using allocator_type = typename Container::allocator_type;
+
+            using Container::begin;
+            using Container::end;
+            using Container::cbegin;
+            using Container::cend;
+            using Container::rbegin;
+            using Container::rend;
+            using Container::size;
+            using Container::empty;
+            using Container::max_size;
+            using Container::reserve;
+            using Container::capacity;
+            using Container::clear;
+            using Container::get_allocator;
+
+        private:
+            Compare compare;
+
+            // the first pair whose key is not less than 'key'.
+            template<class K>
+            iterator lower(const K& key) {
+                return std::lower_bound(this->begin(), this->end(), key, [this](const value_type& v, const K& k) {
+                    return compare(v.first, k);
+                });
+            }
+
+            template<class K>
+            const_iterator lower(const K& key) const {
+                return std::lower_bound(this->begin(), this->end(), key, [this](const value_type& v, const K& k) {
+                    return compare(v.first, k);
+                });
+            }
+
+            template<class It, class K>
+            bool holds(It it, const K& key) const {
+                return it != this->end() && !compare(key, it->first);
+            }
+
+            // keys may arrive as anything comparable with them, but iterators are never keys.
+            template<class K>
+            using keyish = std::enable_if_t<!std::is_convertible<K, const_iterator>::value, int>;
+
+        public:
+            map() = default;
+
+            explicit map(const Allocator& alloc) : Container(alloc) {}
+
+            template<class It>
+            map(It first, It last, const Allocator& alloc = Allocator()) : Container(alloc) {
+                insert(first, last);
+            }
+
+            map(std::initializer_list<value_type> init, const Allocator& alloc = Allocator()) : Container(alloc) {
+                insert(init.begin(), init.end());
+            }
+
+            template<class K, class... Args>
+            std::pair<iterator, bool> emplace(K&& key, Args&&... args) {
+                iterator it = lower(key);
+                if (holds(it, key)) {
+                    return {it, false};
+                }
+                return {Container::emplace(it, std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                        std::forward_as_tuple(std::forward<Args>(args)...)), true};
+            }
+
+            std::pair<iterator, bool> insert(value_type&& value) {
+                return emplace(std::move(value.first), std::move(value.second));
+            }
+
+            std::pair<iterator, bool> insert(const value_type& value) {
+                return emplace(value.first, value.second);
+            }
+
+            template<class It>
+            void insert(It first, It last) {
+                for (; first != last; ++first) {
+                    emplace(first->first, first->second);
+                }
+            }
+
+            template<class K, keyish<K> = 0>
+            T& operator[](K&& key) {
+                return emplace(std::forward<K>(key)).first->second;
+            }
+
+            template<class K>
+            T& at(const K& key) {
+                iterator it = lower(key);
+                if (!holds(it, key)) {
+                    throw std::out_of_range("key not found");
+                }
+                return it->second;
+            }
+
+            template<class K>
+            const T& at(const K& key) const {
+                const_iterator it = lower(key);
+                if (!holds(it, key)) {
+                    throw std::out_of_range("key not found");
+                }
+                return it->second;
+            }
+
+            template<class K>
+            const T& operator[](const K& key) const {
+                return at(key);
+            }
+
+            template<class K>
+            iterator find(const K& key) {
+                iterator it = lower(key);
+                return holds(it, key) ? it : this->end();
+            }
+
+            template<class K>
+            const_iterator find(const K& key) const {
+                const_iterator it = lower(key);
+                return holds(it, key) ? it : this->end();
+            }
+
+            template<class K>
+            size_type count(const K& key) const {
+                return holds(lower(key), key) ? 1 : 0;
+            }
+
+            iterator erase(const_iterator it) {
+                return Container::erase(it);
+            }
+
+            iterator erase(const_iterator first, const_iterator last) {
+                return Container::erase(first, last);
+            }
+
+            template<class K, keyish<K> = 0>
+            size_type erase(const K& key) {
+                iterator it = lower(key);
+                if (!holds(it, key)) {
+                    return 0;
+                }
+                Container::erase(it);
+                return 1;
+            }
+
+            void swap(map& other) {
+                Container::swap(other);
+                std::swap(compare, other.compare);
+            }
+
+            friend bool operator==(const map& a, const map& b) {
+                return static_cast<const Container&>(a) == static_cast<const Container&>(b);
+            }
+
+            friend bool operator!=(const map& a, const map& b) {
+                return !(a == b);
+            }
+
+            friend bool operator<(const map& a, const map& b) {
+                return static_cast<const Container&>(a) < static_cast<const Container&>(b);
+            }
+    };
+}
+
+#endif
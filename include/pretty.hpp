@@ -8,9 +8,41 @@
 #include <sstream>
 #include <vector>
 #include <map>
+#include <array>
+#include <string_view>
 
 namespace pty {
 
+    // every style understood by Palette, valued by its escape code
+    enum class style : unsigned char {
+        // foreground
+        black = 30, red = 31, green = 32,
+        orange = 33, blue = 34, magenta = 35,
+        cyan = 36, white = 37, grey = 90,
+        lightred = 91, lightgreen = 92, yellow = 93,
+        lightblue = 94, lightmagenta = 95, turqoise = 96,
+        // background
+        blackbg = 40, redbg = 41, greenbg = 42,
+        orangebg = 43, bluebg = 44, purplebg = 45,
+        cyanbg = 46, whitebg = 47, greybg = 100,
+        lightredbg = 101, lightgreenbg = 102, yellowbg = 103,
+        lightbluebg = 104, lightpurplebg = 105, turquoisebg = 106,
+        // style
+        normal = 0, bold = 1, dim = 2,
+        italic = 3, underlined = 4, reversefield = 7,
+    };
+
+    // a ColourSet whose stylings are folded into one escape sequence at compile time
+    template<style... S>
+    struct Palette;
+
+    // paints the value with the palette's stylings straight into out, which must support <<
+    template<style... S, typename Out, typename T>
+    Out& paint(Out& out, const T& value);
+    //
+    template<style... S, typename T>
+    const std::string paint(const T& value);
+
     // holds stylings for later use through the 'apply' function or paint(ColourSet)
     class ColourSet;
 
@@ -64,6 +96,61 @@ namespace pty {
     const char * TEMPLATE = "\x1B[%dm";
     const char * RESET = "\033[0m";
 
+    namespace detail {
+        constexpr std::size_t digits(int code) {
+            return code >= 100 ? 3 : code >= 10 ? 2 : 1;
+        }
+
+        // "\x1B[" + codes seperated by ';' + "m", e.g. "\x1B[93;1m"
+        template<style... S>
+        struct escape {
+            static_assert(sizeof...(S) > 0, "a palette needs atleast one style");
+
+            static constexpr std::size_t size = 3 + (sizeof...(S) - 1) + (digits((int)S) + ...);
+
+            static constexpr std::array<char, size + 1> make() {
+                std::array<char, size + 1> out {};
+                const int codes[] = {(int)S...};
+                std::size_t at = 0;
+                out[at++] = '\x1B';
+                out[at++] = '[';
+                for (std::size_t i = 0; i < sizeof...(S); i++) {
+                    if (i > 0) {
+                        out[at++] = ';';
+                    }
+                    std::size_t width = digits(codes[i]);
+                    for (std::size_t d = width, code = codes[i]; d > 0; d--, code /= 10) {
+                        out[at + d - 1] = (char)('0' + code % 10);
+                    }
+                    at += width;
+                }
+                out[at] = 'm';
+                return out;
+            }
+
+            static constexpr std::array<char, size + 1> text = make();
+        };
+    }
+
+    template<style... S>
+    struct Palette {
+        static constexpr std::string_view code {detail::escape<S...>::text.data(), detail::escape<S...>::size};
+        static constexpr std::string_view reset {"\033[0m"};
+    };
+
+    template<style... S, typename Out, typename T>
+    Out& paint(Out& out, const T& value) {
+        out << Palette<S...>::code << value << Palette<S...>::reset;
+        return out;
+    }
+
+    template<style... S, typename T>
+    const std::string paint(const T& value) {
+        std::ostringstream oss;
+        paint<S...>(oss, value);
+        return oss.str();
+    }
+
     class ColourSet {
         private:
             const std::vector<const char *> _styles;
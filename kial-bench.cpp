@@ -0,0 +1,524 @@
+// benchmarks for kial: a synthetic database generator and a harness that times each command against it.
+// results are written as JSON, so runs can be compared by scripts rather than by eye.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <experimental/filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "include/argh.h"
+#include "include/json.hpp"
+#include "include/arena.hpp"
+#include "include/flat.hpp"
+
+namespace nm = nlohmann;
+namespace fs = std::experimental::filesystem;
+
+// the same database type as kial's: sorted-vector objects, with objects and arrays allocated from an arena.
+using arenaJson = nm::basic_json<flat::map, std::vector, std::string, bool, std::int64_t, std::uint64_t, double, arena::allocator>;
+// the same again, on the plain heap, so that the two differ only in where they allocate.
+using flatJson = nm::basic_json<flat::map>;
+
+#define PASSPHRASE "kial-bench-phrase"
+#define DEFAULT_SIZES "1000,100000,1000000"
+#define DEFAULT_THREADS "1,2,4,8,16"
+#define DEFAULT_KEYS "4,8,16,32"
+
+/*/////////////*
+//  SETTINGS  //
+*/////////////*/
+
+// the shape of a generated database.
+struct shape {
+    std::size_t items = 1000;
+    std::size_t keys = 10;
+    std::size_t valueSize = 32;
+    double zipf = 1.1; // skew of the term distribution; higher means a few terms dominate
+    std::size_t vocabulary = 10000;
+    unsigned seed = 64;
+};
+
+// splits 'raw' on commas into numbers.
+std::vector<std::size_t> numbers(const std::string raw) {
+    std::stringstream stream(raw);
+    std::vector<std::size_t> out;
+    std::string segment;
+    while (std::getline(stream, segment, ',')) {
+        out.push_back(std::stoull(segment));
+    }
+    return out;
+}
+
+shape getShape(const argh::parser& args) {
+    shape s;
+    args({"n", "items"}, s.items) >> s.items;
+    args({"k", "keys"}, s.keys) >> s.keys;
+    args({"z", "value-size"}, s.valueSize) >> s.valueSize;
+    args({"zipf"}, s.zipf) >> s.zipf;
+    args({"vocabulary"}, s.vocabulary) >> s.vocabulary;
+    args({"seed"}, s.seed) >> s.seed;
+    return s;
+}
+
+/*//////////////*
+//  GENERATOR  //
+*//////////////*/
+
+// draws term ranks from a Zipf distribution: rank r is picked with probability proportional to 1/r^s.
+class zipfian {
+    private:
+        std::vector<double> cdf;
+        std::uniform_real_distribution<double> unit {0.0, 1.0};
+
+    public:
+        zipfian(std::size_t n, double s) : cdf(n) {
+            double total = 0;
+            for (std::size_t r = 0; r < n; r++) {
+                total += 1.0 / std::pow(r + 1, s);
+                cdf[r] = total;
+            }
+            for (auto& c : cdf) {
+                c /= total;
+            }
+        }
+
+        template<typename R>
+        std::size_t operator()(R& rng) {
+            return std::lower_bound(cdf.begin(), cdf.end(), unit(rng)) - cdf.begin();
+        }
+};
+
+// a pronounceable, unique word for each rank, so searches have something realistic to find.
+const std::string term(std::size_t rank) {
+    static const char * syllables[] = {"ka", "lo", "mi", "ne", "ru", "sa", "ti", "vo", "ze", "po", "qui", "da", "fe", "gu", "ho", "ja"};
+    std::string word;
+    do {
+        word += syllables[rank % 16];
+        rank /= 16;
+    } while (rank > 0);
+    return word;
+}
+
+// writes a database of the given shape to 'path', formatted exactly as kial writes it.
+// items are streamed straight to the file, so any size can be generated in constant memory.
+void generate(const shape& s, const std::string path) {
+    std::mt19937_64 rng(s.seed);
+    zipfian ranks(s.vocabulary, s.zipf);
+    std::uniform_int_distribution<int> amounts(0, 1000000);
+
+    // keys sort after 'identifier' and among themselves as strings, like kial's own output
+    std::vector<std::pair<std::string, std::size_t>> keys;
+    for (std::size_t k = 0; k < s.keys; k++) {
+        keys.push_back({"key" + std::to_string(k), k});
+    }
+    std::sort(keys.begin(), keys.end());
+
+    std::ofstream out(path);
+    out << "[";
+    for (std::size_t i = 0; i < s.items; i++) {
+        out << (i == 0 ? "\n" : ",\n") << "    {\n";
+        out << "        \"identifier\": \"item-" << i << "\"";
+        for (const auto& [name, k] : keys) {
+            out << ",\n        \"" << name << "\": ";
+            switch (k % 4) {
+                case 1:
+                    out << amounts(rng);
+                    break;
+                case 3:
+                    out << (amounts(rng) % 2 == 0 ? "true" : "false");
+                    break;
+                default: {
+                    std::string value;
+                    while (value.size() < s.valueSize) {
+                        value += (value.empty() ? "" : " ") + term(ranks(rng));
+                    }
+                    out << '"' << value << '"';
+                }
+            }
+        }
+        out << "\n    }";
+    }
+    out << (s.items == 0 ? "]\n" : "\n]\n");
+}
+
+/*////////////*
+//  HARNESS  //
+*////////////*/
+
+// runs kial with 'args' inside 'cwd', discarding its output. returns the wall time in seconds.
+// a run that does not exit cleanly would time a failure, so it ends the benchmark instead.
+// kial keeps its database snapshots in 'cwd'/cache rather than the user's own cache.
+double run(const std::string kial, const std::string cwd, const std::vector<std::string> args) {
+    std::vector<char *> argv;
+    argv.push_back((char *)kial.c_str());
+    for (const auto& a : args) {
+        argv.push_back((char *)a.c_str());
+    }
+    argv.push_back(nullptr);
+
+    auto start = std::chrono::steady_clock::now();
+    pid_t child = fork();
+    if (child == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, 1);
+        dup2(null, 2);
+        if (chdir(cwd.c_str()) != 0 || setenv("XDG_CACHE_HOME", (cwd + "/cache").c_str(), 1) != 0) {
+            _exit(127);
+        }
+        execv(kial.c_str(), argv.data());
+        _exit(127);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) == 127) {
+        std::cerr << "kial-bench: failed to run '" << kial << "'." << std::endl;
+        exit(1);
+    }
+    if (WEXITSTATUS(status) != 0) {
+        std::cerr << "kial-bench: '" << kial;
+        for (const auto& a : args) {
+            std::cerr << " " << a;
+        }
+        std::cerr << "' exited with " << WEXITSTATUS(status) << "." << std::endl;
+        exit(1);
+    }
+    return std::chrono::duration<double>(elapsed).count();
+}
+
+// a single benchmarked command.
+struct operation {
+    std::string name;
+    bool mutates; // needs a fresh copy of the database for every run
+    std::function<std::vector<std::string>(const shape&)> args;
+};
+
+// times every operation against databases of each size, appending one result per measurement.
+void harness(const argh::parser& cmd, nm::json& results) {
+    std::string kial = fs::absolute(cmd({"kial"}, "./kial").str()).string();
+    std::vector<std::size_t> sizes = numbers(cmd({"sizes"}, DEFAULT_SIZES).str());
+    std::vector<std::size_t> threads = numbers(cmd({"threads"}, DEFAULT_THREADS).str());
+    int repeat = 3;
+    cmd({"repeat"}, repeat) >> repeat;
+    shape base = getShape(cmd);
+
+    // something from the middle of the distribution, so searches match some items but not all
+    std::string common = term(base.vocabulary / 100);
+
+    std::vector<operation> operations = {
+        {"add", true, [](const shape&) { return std::vector<std::string>{"-o", "database.json", "-+", "bench-new"}; }},
+        {"value", true, [](const shape& s) { return std::vector<std::string>{"-o", "database.json", "-@", "item-" + std::to_string(s.items / 2), "-k", "key1", "-t", "int", "-v", "42"}; }},
+        {"pop", true, [](const shape& s) { return std::vector<std::string>{"-o", "database.json", "-@", "item-" + std::to_string(s.items / 2), "-k", "key0", "-p"}; }},
+        {"erase", true, [](const shape& s) { return std::vector<std::string>{"-o", "database.json", "-@", "item-" + std::to_string(s.items / 2), "-!"}; }},
+        {"search", false, [&](const shape&) { return std::vector<std::string>{"-o", "database.json", "-c", "-s", common}; }},
+        {"readable", false, [](const shape&) { return std::vector<std::string>{"-o", "database.json", "-c", "-r"}; }},
+        {"count", false, [](const shape&) { return std::vector<std::string>{"-o", "database.json", "-C"}; }},
+    };
+
+    fs::path dir = fs::temp_directory_path() / ("kial-bench-" + std::to_string(getpid()));
+    fs::create_directories(dir);
+    fs::path pristine = dir / "pristine.json";
+    fs::path database = dir / "database.json";
+
+    for (std::size_t items : sizes) {
+        shape s = base;
+        s.items = items;
+        std::cerr << "kial-bench: generating " << items << " items..." << std::endl;
+        generate(s, pristine.string());
+        std::size_t bytes = fs::file_size(pristine);
+
+        // times 'args' 'repeat' times and records the best and median. cold runs start without a snapshot
+        // of the database, so they load it from JSON; warm ones have one left by an untimed run beforehand.
+        auto measure = [&](const std::string name, bool mutates, const std::vector<std::string> args, unsigned workers, bool warm = false) {
+            std::vector<double> times;
+            for (int r = 0; r < repeat; r++) {
+                if (mutates || r == 0) {
+                    fs::copy_file(pristine, database, fs::copy_options::overwrite_existing);
+                }
+                if (!warm) {
+                    fs::remove_all(dir / "cache");
+                } else if (r == 0) {
+                    run(kial, dir.string(), {"-o", "database.json", "-S"});
+                }
+                times.push_back(run(kial, dir.string(), args));
+            }
+            std::sort(times.begin(), times.end());
+            nm::json result = {
+                {"operation", name},
+                {"items", items},
+                {"keys", s.keys},
+                {"value_size", s.valueSize},
+                {"bytes", bytes},
+                {"repeat", repeat},
+                {"cache", warm ? "warm" : "cold"},
+                {"best_seconds", times.front()},
+                {"median_seconds", times[times.size() / 2]},
+                {"mb_per_second", bytes / 1e6 / times[times.size() / 2]},
+            };
+            if (workers > 0) {
+                result["threads"] = workers;
+            }
+            std::cerr << "kial-bench: " << name << (workers > 0 ? " x" + std::to_string(workers) : "") << (warm ? " (warm)" : "") << " @ " << items
+                    << ": " << times[times.size() / 2] << "s" << std::endl;
+            results.push_back(result);
+        };
+
+        for (const auto& op : operations) {
+            measure(op.name, op.mutates, op.args(s), 0);
+        }
+        // a changed database is never served from its snapshot, so only the readers are worth timing warm
+        for (const auto& op : operations) {
+            if (!op.mutates) {
+                measure(op.name, false, op.args(s), 0, true);
+            }
+        }
+
+        // encryption scales with threads, so sweep them
+        for (std::size_t t : threads) {
+            measure("encrypt", false, {"-o", "database.json", "-j", std::to_string(t), "-e", PASSPHRASE}, t);
+        }
+        run(kial, dir.string(), {"-o", "database.json", "-e", PASSPHRASE});
+        for (std::size_t t : threads) {
+            measure("decrypt", false, {"-o", "encrypted.json", "-j", std::to_string(t), "-d", PASSPHRASE}, t);
+        }
+    }
+
+    fs::remove_all(dir);
+}
+
+/*///////////////*
+//  ALLOCATION  //
+*///////////////*/
+
+// every heap allocation made by this process, counted by the operator new below.
+std::atomic<std::size_t> allocations {0};
+
+void * operator new(std::size_t size) {
+    allocations++;
+    if (void * p = std::malloc(size > 0 ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void * operator new(std::size_t size, std::align_val_t align) {
+    allocations++;
+    std::size_t a = (std::size_t)align;
+    if (void * p = std::aligned_alloc(a, (size + a - 1) / a * a)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+// gcc sees the malloc/free pairs above and below as a mismatch with new/delete; they are not.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete(void * p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void * p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void * p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void * p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+// parses 'text' as J and then frees it, recording how long each took and how many heap allocations parsing made.
+template<typename J>
+nm::json parseAndFree(const std::string& text, const std::string allocator) {
+    using clock = std::chrono::steady_clock;
+    clock::time_point start, parsed, freed;
+    std::size_t before;
+    {
+        std::unique_ptr<arena::monotonic> memory;
+        if (allocator == "arena") {
+            memory = std::make_unique<arena::monotonic>();
+        }
+        before = allocations;
+        start = clock::now();
+        {
+            J j = J::parse(text);
+            parsed = clock::now();
+            before = allocations - before;
+        }
+    }
+    freed = clock::now();
+    return {
+        {"operation", "parse"},
+        {"allocator", allocator},
+        {"parse_seconds", std::chrono::duration<double>(parsed - start).count()},
+        {"free_seconds", std::chrono::duration<double>(freed - parsed).count()},
+        {"heap_allocations", before},
+    };
+}
+
+// parses databases of each size with the default allocator and with kial's arena, in process.
+void allocation(const argh::parser& cmd, nm::json& results) {
+    std::vector<std::size_t> sizes = numbers(cmd({"sizes"}, DEFAULT_SIZES).str());
+    int repeat = 3;
+    cmd({"repeat"}, repeat) >> repeat;
+    shape base = getShape(cmd);
+
+    fs::path file = fs::temp_directory_path() / ("kial-bench-" + std::to_string(getpid()) + ".json");
+    for (std::size_t items : sizes) {
+        shape s = base;
+        s.items = items;
+        std::cerr << "kial-bench: generating " << items << " items..." << std::endl;
+        generate(s, file.string());
+        std::ifstream in(file);
+        std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+        for (int r = 0; r < repeat; r++) {
+            for (auto& result : {parseAndFree<flatJson>(text, "heap"), parseAndFree<arenaJson>(text, "arena")}) {
+                nm::json row = result;
+                row["items"] = items;
+                row["bytes"] = text.size();
+                std::cerr << "kial-bench: parse (" << row["allocator"].get<std::string>() << ") @ " << items << ": "
+                        << row["parse_seconds"].get<double>() << "s parse, " << row["free_seconds"].get<double>() << "s free, "
+                        << row["heap_allocations"].get<std::size_t>() << " allocations" << std::endl;
+                results.push_back(row);
+            }
+        }
+    }
+    fs::remove(file);
+}
+
+/*////////////*
+//  OBJECTS  //
+*////////////*/
+
+// times inserting, looking up and iterating over 'keys' keys in each of 'count' objects of type J.
+// each result is in nanoseconds per key.
+template<typename J>
+nm::json objectOps(std::size_t keys, std::size_t count, const std::string container) {
+    using clock = std::chrono::steady_clock;
+    std::vector<std::string> names;
+    for (std::size_t k = 0; k < keys; k++) {
+        names.push_back("key" + std::to_string(k));
+    }
+    // keys arrive, and are asked for, in no particular order
+    std::mt19937 random(64);
+    std::vector<std::string> inserting = names, looking = names;
+    std::shuffle(inserting.begin(), inserting.end(), random);
+    std::shuffle(looking.begin(), looking.end(), random);
+
+    std::vector<J> objects(count, J::object());
+    auto start = clock::now();
+    for (auto& j : objects) {
+        std::int64_t v = 0;
+        for (auto& name : inserting) {
+            j[name] = v++;
+        }
+    }
+    auto inserted = clock::now();
+    std::int64_t sum = 0;
+    for (auto& j : objects) {
+        for (auto& name : looking) {
+            sum += j.find(name)->template get<std::int64_t>();
+        }
+    }
+    auto looked = clock::now();
+    for (auto& j : objects) {
+        for (auto& kav : j.items()) {
+            sum += kav.key().size() + kav.value().template get<std::int64_t>();
+        }
+    }
+    auto iterated = clock::now();
+
+    double per = 1e9 / (keys * count);
+    return {
+        {"operation", "object"},
+        {"container", container},
+        {"keys", keys},
+        {"objects", count},
+        {"insert_ns", std::chrono::duration<double>(inserted - start).count() * per},
+        {"lookup_ns", std::chrono::duration<double>(looked - inserted).count() * per},
+        {"iterate_ns", std::chrono::duration<double>(iterated - looked).count() * per},
+        {"checksum", sum},
+    };
+}
+
+// compares nlohmann's std::map objects against kial's sorted vectors at typical item sizes.
+void objects(const argh::parser& cmd, nm::json& results) {
+    std::vector<std::size_t> keys = numbers(cmd({"keys"}, DEFAULT_KEYS).str());
+    std::size_t count = 100000;
+    cmd({"objects"}, count) >> count;
+    int repeat = 3;
+    cmd({"repeat"}, repeat) >> repeat;
+
+    for (std::size_t k : keys) {
+        for (int r = 0; r < repeat; r++) {
+            for (auto& row : {objectOps<nm::json>(k, count, "map"), objectOps<flatJson>(k, count, "flat")}) {
+                std::cerr << "kial-bench: objects (" << row["container"].get<std::string>() << ") @ " << k << " keys: "
+                        << row["insert_ns"].get<double>() << "ns insert, " << row["lookup_ns"].get<double>() << "ns lookup, "
+                        << row["iterate_ns"].get<double>() << "ns iterate" << std::endl;
+                results.push_back(row);
+            }
+        }
+    }
+}
+
+/*/////////*
+//  MAIN  //
+*/////////*/
+
+void usage() {
+    std::cerr << "usage:\n"
+            "  kial-bench generate <path> [--items N] [--keys K] [--value-size S] [--zipf s] [--vocabulary V] [--seed x]\n"
+            "  kial-bench run [--kial ./kial] [--sizes " DEFAULT_SIZES "] [--threads " DEFAULT_THREADS "] [--repeat 3]\n"
+            "                 [--keys K] [--value-size S] [--zipf s] [--out results.json]\n"
+            "  kial-bench alloc [--sizes " DEFAULT_SIZES "] [--repeat 3] [--keys K] [--value-size S] [--out results.json]\n"
+            "  kial-bench objects [--keys " DEFAULT_KEYS "] [--objects 100000] [--repeat 3] [--out results.json]\n";
+}
+
+int main(int argc, char ** argv) {
+    argh::parser cmd(argc, argv, argh::parser::PREFER_PARAM_FOR_UNREG_OPTION);
+    std::string mode = cmd[1];
+
+    if (mode == "generate" && cmd.size() > 2) {
+        generate(getShape(cmd), cmd[2]);
+        return 0;
+    }
+
+    nm::json results = nm::json::array();
+    if (mode == "run") {
+        harness(cmd, results);
+    } else if (mode == "alloc") {
+        allocation(cmd, results);
+    } else if (mode == "objects") {
+        objects(cmd, results);
+    } else {
+        usage();
+        return 1;
+    }
+
+    // machine-readable results, to a file or stdout
+    std::string out = cmd({"out"}).str();
+    if (out == "") {
+        std::cout << std::setw(4) << results << std::endl;
+    } else {
+        std::ofstream file(out);
+        file << std::setw(4) << results << std::endl;
+    }
+}
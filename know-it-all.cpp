@@ -2,24 +2,78 @@
 // please, ignore the messiness (and laziness) of some of this code, a cleanup is due!
 
 #include <experimental/filesystem>
+#include <algorithm>
 #include <functional>
 #include <string>
+#include <cstring>
+#include <charconv>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
 #include <vector>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
 #include <fstream>
 #include <istream>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <cassert>
+#include <chrono>
+#include <array>
+#include <cmath>
 
 #ifdef _WIN32
 #include <iostream> // required for win compilers
+#include <io.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/resource.h>
+#include <sys/mman.h>
 #endif
+#include <fcntl.h>
+#include <sys/stat.h>
 #include "include/argh.h"
 #include "include/pretty.hpp"
 #include "include/json.hpp"
+#include "include/arena.hpp"
+#include "include/flat.hpp"
 
 namespace nm = nlohmann;
 namespace fs = std::experimental::filesystem;
+using style = pty::style;
+
+// the database type. its objects and arrays are allocated from the arena set up in main, which lives for
+// the whole command, so parsing is a series of pointer bumps and nothing is freed piecemeal at exit.
+// objects are sorted vectors rather than trees, as items only have a handful of keys each.
+// strings stay std::string, so that keys and values mix freely with the rest of kial.
+using json = nm::basic_json<flat::map, std::vector, std::string, bool, std::int64_t, std::uint64_t, double, arena::allocator>;
 
 // min lengths
 #define MINPASS 8
+// bytes buffered before console output is flushed
+#define SINK_SIZE (64 << 10)
+// registers used by each distinct-value estimate are 2^HLL_BITS
+#define HLL_BITS 10
+// bytes handed to each worker per encrypt/decrypt block
+#define SHIFT_CHUNK (4 << 20)
+// most worker threads any one command starts
+#define MAX_THREADS 256u
+// appended to the database's path to name the file its lock is taken on
+#define LOCK_SUFFIX ".lock"
+// appended to the database's path to name its sidecar index
+#define INDEX_SUFFIX ".idx"
+// first bytes of a sidecar index, changed whenever its layout does
+#define INDEX_MAGIC "kialidx3"
+// first bytes of a database snapshot, changed whenever its layout does
+#define CACHE_MAGIC "kialsnp3"
+// bytes from each end of the database hashed to help tell if an index is stale
+#define INDEX_SAMPLE 4096
 // used to determine whether a parameter's value is empty
 #define ABSENT "  "
 #define DATABASE (std::string)"./database.json"
@@ -31,6 +85,11 @@ namespace fs = std::experimental::filesystem;
 #define OUTFILE_GET_ERROR ": No outfile provided. Run with '-? o' for more information."
 #define ITEM_GET_ERROR ": No item identifier provided. Run with '-? @' for more information."
 #define ITEM_EXISTS_ERROR ": The item identifier provided does not exist in the database."
+#define ITEMS_EXIST_ERROR ": Some of the item identifiers provided do not exist in the database."
+#define NO_ITEMS_MATCH_ERROR ": No items in the database match the pattern provided."
+#define IDENTIFIER_ERROR ": Identifiers cannot contain ',', '*' or '?', begin with '@' or 'where ', or be '[ALL]', as @/item would read them as more than one."
+#define ITEM_FILE_ERROR ": Could not read the file of item identifiers provided."
+#define PREDICATE_ERROR ": The condition provided is malformed. Run with '-? @' for more information."
 #define NO_KEY_ERROR ": No key(s) provided."
 #define INVALID_TYPE_ERROR ": Invalid type. Run with '-? t' for more information."
 #define CANNOT_POP_KEY_IDENTIFIER_ERROR ": Popping the 'identifier' key is prohibited.."
@@ -46,8 +105,23 @@ namespace fs = std::experimental::filesystem;
 #define PASSCODE_END_SERIES_ERROR ": Your passcode cannot end with a series of characters (it is obsolete)."
 #define KEY_VAL_MATCH_ERROR ": Not enough keys for the values provided, or vice versa."
 #define TOO_MANY_OTYPES_ERROR ": Too many types provided for the number of values."
+#define INVALID_THREADS_ERROR ": The number of threads must be a whole number above zero."
+#define TOO_MANY_THREADS_ERROR ": Too many threads; using as many as are allowed instead."
+#define THREAD_START_ERROR ": Could not start every worker thread."
+#define INVALID_PROFILE_ERROR ": The profile format must be 'table' or 'json'."
+#define INVALID_AMOUNT_ERROR ": Expected a whole number."
+#define INVALID_CURSOR_ERROR ": The cursor provided is malformed. Use the one printed at the end of the last page."
+#define INVALID_SORT_ERROR ": Expected a key to sort by, optionally followed by ':asc' or ':desc'."
+#define SORT_CURSOR_ERROR ": Sorted pages cannot be resumed with a cursor; use m/offset instead."
+#define INVALID_AGGREGATE_ERROR ": Expected aggregates like 'count, sum(key), avg(key), min(key), max(key)', optionally followed by 'by key'."
+#define CURSOR_MOVED_ERROR ": The database has changed since the cursor was made; the page may skip or repeat items."
+#define WRITE_ERROR ": Could not write the database; it has been left as it was."
+#define SCRIPT_ERROR ": Could not read the commands file provided."
+#define NOT_IN_TRANSACTION_ERROR ": Cannot be used within a transaction."
+#define TRANSACTION_FAILED_ERROR ": A command failed, so nothing was committed."
+#define PARAMETER_NAMES_ERROR "Two parameters share a name, or there are too many names to index."
 
-// holds a parameter's data and its final value.
+// holds a parameter's data.
 struct parameter {
     std::vector<std::string> names;
     std::string passed;
@@ -55,8 +129,6 @@ struct parameter {
     bool blockingFunc;
     bool passedRequired;
 
-    std::string result;
-
     std::function<void(parameter&, const std::string)> execute;
 
     // forms a string containing all names seperated by a slash or 'sep'.
@@ -65,251 +137,3100 @@ struct parameter {
         for (const auto& n : names) {
             o += (names.back() == n) ? n : n + sep;
         }
-        return o;
-    }
-
-    parameter(const std::initializer_list<std::string> names, const std::string description, 
-            const std::string passed, std::function<void(parameter&, const std::string)> execute, bool passedRequired = true,
-            bool blockingFunc = false) : names(names), description(description), passed(passed), passedRequired(passedRequired),
-            blockingFunc(blockingFunc), execute(execute) {}
-};
+        return o;
+    }
+
+    parameter(const std::initializer_list<std::string> names, const std::string description, 
+            const std::string passed, std::function<void(parameter&, const std::string)> execute, bool passedRequired = true,
+            bool blockingFunc = false) : names(names), description(description), passed(passed), passedRequired(passedRequired),
+            blockingFunc(blockingFunc), execute(execute) {}
+};
+
+std::vector<parameter> mainParameters;
+
+// what became of running the parameters passed on a command line.
+enum class ran { through, blocked, failed };
+
+ran run(int argc, const char * const argv[], int& passed, std::function<bool(parameter&)> admit = nullptr);
+
+/*//////////////////*
+//  CONFIGURATION  //
+*//////////////////*/
+
+// the resolved values of every non-blocking parameter, filled in once as they are parsed.
+// hot paths read these fields directly instead of looking parameters up by name.
+struct settings {
+    bool colourless = false;
+    bool verbose = false;
+    bool force = false;
+    unsigned threads = 0; // 0 means one per core
+    std::size_t limit = SIZE_MAX; // items shown per page
+    std::size_t offset = 0; // matching items skipped before the page
+    std::string cursor;
+    std::string sort; // key[:desc]
+    std::size_t top = SIZE_MAX; // items kept once sorted
+    std::size_t slack = SIZE_MAX; // padding after each item; SIZE_MAX keeps what the database has
+    bool profile = false;
+    bool profileJson = false;
+    std::string outfile;
+    std::string item;
+    std::vector<std::string> keys;
+    std::vector<std::string> values;
+    std::vector<std::string> types;
+};
+
+settings config;
+
+// a collision-free hash table over every parameter name, built from mainParameters itself so it cannot fall out of step.
+struct nametable {
+    static constexpr std::size_t slots = 256; // power of two, comfortably above the number of names
+
+    std::uint32_t seed = 0;
+    std::int16_t table[slots] = {};
+    std::vector<std::pair<std::string_view, int>> names;
+
+    static constexpr std::uint32_t hash(std::string_view name, std::uint32_t seed) {
+        std::uint32_t h = 2166136261u ^ seed;
+        for (char c : name) {
+            h = (h ^ (unsigned char)c) * 16777619u;
+        }
+        // spread the high bits into the low ones that pick the slot
+        h = (h ^ (h >> 16)) * 0x85ebca6bu;
+        h = (h ^ (h >> 13)) * 0xc2b2ae35u;
+        return h ^ (h >> 16);
+    }
+
+    // indexes every name in 'parameters' by its position, searching for a seed that leaves no collisions.
+    // false if two parameters share a name, or there are too many names to index.
+    bool build(const std::vector<parameter>& parameters) {
+        names.clear();
+        for (std::size_t at = 0; at < parameters.size(); at++) {
+            for (const auto& name : parameters[at].names) {
+                for (const auto& other : names) {
+                    if (other.first == name) {
+                        return false;
+                    }
+                }
+                names.emplace_back(name, (int)at);
+            }
+        }
+        if (names.size() > slots / 2) {
+            return false;
+        }
+        for (seed = 0; ; seed++) {
+            bool clean = true;
+            std::fill(std::begin(table), std::end(table), -1);
+            for (std::size_t i = 0; i < names.size() && clean; i++) {
+                auto& slot = table[hash(names[i].first, seed) & (slots - 1)];
+                clean = slot == -1;
+                slot = i;
+            }
+            if (clean) {
+                return true;
+            }
+        }
+    }
+
+    // position of the named parameter in mainParameters, or -1 if there is no such name.
+    int find(std::string_view name) const {
+        int i = table[hash(name, seed) & (slots - 1)];
+        return (i != -1 && names[i].first == name) ? names[i].second : -1;
+    }
+};
+
+nametable parameterNames;
+
+// splits 'raw' on commas.
+const std::vector<std::string> split(const std::string raw) {
+    std::stringstream stream = std::stringstream(raw);
+    std::vector<std::string> segments;
+    std::string segment;
+    while(std::getline(stream, segment, ',')) {
+        segments.push_back(segment);
+    }
+    return segments;
+}
+
+// strips the whitespace from either end of 'raw'.
+std::string trim(const std::string raw) {
+    std::size_t begin = raw.find_first_not_of(" \t");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    return raw.substr(begin, raw.find_last_not_of(" \t") - begin + 1);
+}
+
+/*///////////*
+//  OUTPUT  //
+*///////////*/
+
+// a fixed-size buffer in front of a file descriptor.
+// everything rendered or logged goes through here, so output costs one write() per SINK_SIZE bytes.
+class sink {
+    private:
+        int fd;
+        std::size_t used = 0;
+        char buffer[SINK_SIZE];
+
+        void drain(const char * data, std::size_t size) {
+            while (size > 0) {
+#ifdef _WIN32
+                int done = _write(fd, data, (unsigned)size);
+#else
+                ssize_t done = ::write(fd, data, size);
+#endif
+                if (done <= 0) {
+                    return; // nowhere left to write to
+                }
+                data += done;
+                size -= done;
+            }
+        }
+
+    public:
+        sink(int fd) : fd(fd) {}
+
+        ~sink() {
+            flush();
+        }
+
+        void flush() {
+            drain(buffer, used);
+            used = 0;
+        }
+
+        sink& put(const char * data, std::size_t size) {
+            if (used + size > SINK_SIZE) {
+                flush();
+                // too big to be worth copying
+                if (size > SINK_SIZE) {
+                    drain(data, size);
+                    return *this;
+                }
+            }
+            std::memcpy(buffer + used, data, size);
+            used += size;
+            return *this;
+        }
+
+        sink& operator<<(const std::string& value) {
+            return put(value.data(), value.size());
+        }
+
+        sink& operator<<(const char * value) {
+            return put(value, std::strlen(value));
+        }
+
+        sink& operator<<(std::string_view value) {
+            return put(value.data(), value.size());
+        }
+
+        sink& operator<<(char value) {
+            return put(&value, 1);
+        }
+
+        template<typename N, typename = std::enable_if_t<std::is_arithmetic_v<N>>>
+        sink& operator<<(N value) {
+            char digits[32];
+            auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+            return put(digits, end - digits);
+        }
+
+        sink& operator<<(const json& value) {
+            return *this << value.dump();
+        }
+};
+
+sink console(1);
+sink diagnostics(2);
+
+/*//////////////*
+//  COLOURING  //
+*//////////////*/
+
+// a proxy for the paint function, used for c/colourless parameter.
+// styles are folded into their escape sequence at compile time, so painting is just a few copies.
+template<style... S, typename T>
+sink& paint(sink& out, const T& value) {
+    if (config.colourless) {
+        return out << value;
+    }
+    return pty::paint<S...>(out, value);
+}
+
+template<style... S, typename T>
+const std::string paint(const T& value) {
+    if (config.colourless) {
+        std::ostringstream oss;
+        oss << value;
+        return oss.str();
+    }
+    return pty::paint<S...>(value);
+}
+
+// fills 'at' with the offset of every non-overlapping 'term' in 'value', reusing its storage.
+// returns whether anything was found.
+bool matches(std::string_view value, std::string_view term, std::vector<std::size_t>& at) {
+    at.clear();
+    if (term.empty()) {
+        return false;
+    }
+    for (std::size_t place = value.find(term); place != std::string_view::npos; place = value.find(term, place + term.size())) {
+        at.push_back(place);
+    }
+    return !at.empty();
+}
+
+// paints 'value' into 'out' with S, reversing the 'size' bytes starting at each offset in 'at'.
+template<style... S>
+sink& highlight(sink& out, std::string_view value, const std::vector<std::size_t>& at, std::size_t size) {
+    if (at.empty()) {
+        return paint<S...>(out, value);
+    }
+    std::size_t place = 0;
+    for (std::size_t match : at) {
+        if (match > place) {
+            paint<S...>(out, value.substr(place, match - place));
+        }
+        paint<S..., style::reversefield>(out, value.substr(match, size));
+        place = match + size;
+    }
+    if (place < value.size()) {
+        paint<S...>(out, value.substr(place));
+    }
+    return out;
+}
+
+/*//////////////*
+//  PROFILING  //
+*//////////////*/
+
+// where time goes within a parameter. 'other' is anything not covered by the rest.
+enum class phase { other, parse, scan, render, serialize, crypt, wait, count };
+const char * PHASES[] = {"other", "parse", "scan", "render", "serialize", "crypt", "wait"};
+
+// what P/profile records for each parameter executed.
+struct measurement {
+    std::string parameter;
+    double wall = 0;
+    std::array<double, (int)phase::count> phases {};
+    std::uintmax_t read = 0; // bytes
+    std::uintmax_t written = 0; // bytes
+    std::uintmax_t items = 0;
+    long peak = 0; // resident set, KiB
+};
+
+// times parameters and the phases within them with a monotonic clock.
+// phases nest: entering one pauses whichever was running, so every moment is counted once.
+class profiler {
+    private:
+        using clock = std::chrono::steady_clock;
+
+        std::vector<measurement> done;
+        phase active = phase::other;
+        clock::time_point started;
+        clock::time_point since;
+
+        static long peakResidentKiB() {
+#ifdef _WIN32
+            return 0; // not measured on windows
+#else
+            struct rusage usage;
+            getrusage(RUSAGE_SELF, &usage);
+            return usage.ru_maxrss;
+#endif
+        }
+
+    public:
+        measurement current;
+
+        // charges the time since the last switch to the active phase, then makes 'next' active.
+        phase swap(phase next) {
+            if (!config.profile) {
+                return next;
+            }
+            auto now = clock::now();
+            current.phases[(int)active] += std::chrono::duration<double>(now - since).count();
+            since = now;
+            std::swap(active, next);
+            return next;
+        }
+
+        void begin(const std::string parameter) {
+            current = measurement();
+            current.parameter = parameter;
+            active = phase::other;
+            started = since = clock::now();
+        }
+
+        void end() {
+            if (!config.profile) {
+                return;
+            }
+            swap(phase::other);
+            current.wall = std::chrono::duration<double>(clock::now() - started).count();
+            current.peak = peakResidentKiB();
+            done.push_back(current);
+            current = measurement();
+        }
+
+        // writes everything measured so far to stderr, as a table or as JSON.
+        void report() {
+            if (!config.profile || done.empty()) {
+                return;
+            }
+            if (config.profileJson) {
+                json out = json::array();
+                for (const auto& m : done) {
+                    json phases;
+                    for (int p = 0; p < (int)phase::count; p++) {
+                        phases[PHASES[p]] = m.phases[p];
+                    }
+                    out.push_back({{"parameter", m.parameter}, {"wall", m.wall}, {"phases", phases},
+                            {"bytes_read", m.read}, {"bytes_written", m.written}, {"items", m.items}, {"peak_rss_kib", m.peak}});
+                }
+                diagnostics << out.dump(4) << '\n';
+            } else {
+                char row[256];
+                std::snprintf(row, sizeof(row), "%-14s %9s %9s %9s %9s %9s %9s %9s %9s %12s %12s %9s %10s\n", "parameter", "wall",
+                        PHASES[1], PHASES[2], PHASES[3], PHASES[4], PHASES[5], PHASES[6], PHASES[0], "read", "written", "items", "peak KiB");
+                diagnostics << row;
+                for (const auto& m : done) {
+                    std::snprintf(row, sizeof(row), "%-14s %9.4f %9.4f %9.4f %9.4f %9.4f %9.4f %9.4f %9.4f %12ju %12ju %9ju %10ld\n",
+                            m.parameter.c_str(), m.wall, m.phases[1], m.phases[2], m.phases[3], m.phases[4], m.phases[5], m.phases[6], m.phases[0],
+                            m.read, m.written, m.items, m.peak);
+                    diagnostics << row;
+                }
+            }
+            done.clear();
+            diagnostics.flush();
+        }
+};
+
+profiler profile;
+
+// charges the time it is alive for to a phase.
+class timer {
+    private:
+        phase outer;
+
+    public:
+        timer(phase p) : outer(profile.swap(p)) {}
+
+        ~timer() {
+            profile.swap(outer);
+        }
+};
+
+/*////////////*
+//  LOGGING  //
+*////////////*/
+
+// fatal errors raised so far, counting those that F/force carried on past.
+int fatalities = 0;
+
+// returns a fatal error and exits.
+template<typename T>
+int fatal(T sad, int status = 1) {
+    fatalities++;
+    paint<style::lightred>(console, sad) << " [";
+    paint<style::red, style::dim>(console, status) << "]\n";
+    if (!config.force) {
+        console.flush();
+        profile.end();
+        profile.report();
+        exit(status);
+    }
+    return status;
+}
+
+// middlepoint of fatal and success.
+template<typename T>
+float warning(T headscratch, float status = 0.5) {
+    if (config.verbose) {
+        paint<style::yellow>(console, headscratch) << " [";
+        paint<style::yellow, style::dim>(console, status) << "]\n";
+    }
+    return status;
+}
+
+// the opposite of fatal.
+template<typename T>
+int success(T hooray, int status = 0) {
+    paint<style::lightgreen>(console, hooray) << " [";
+    paint<style::green>(console, status) << "]\n";
+    return status;
+}
+
+/*////////////*
+//  LOCKING  //
+*////////////*/
+
+// writers never change the database under a reader: each publishes a whole new generation of it, written
+// beside it and renamed over it in one step. a reader that already has the old generation open carries on
+// reading it undisturbed, and the system frees it once the last reader lets go, so readers never wait for
+// writers nor writers for readers. writers do queue up for each other, through this lock.
+
+// the writers' lock on the database at 'path', shared by every kial process through flock() on a file beside it.
+// commands that write take it before they read and hold it until they have published, so no update is lost.
+// within a process it nests, so taking it again costs nothing. windows goes without.
+class lock {
+    private:
+        struct held {
+            int fd = -1;
+            int depth = 0;
+        };
+
+        static std::map<std::string, held>& table() {
+            static std::map<std::string, held> locks;
+            return locks;
+        }
+
+        std::string path;
+
+    public:
+        lock(const std::string path) : path(path) {
+            held& h = table()[path];
+            if (h.depth++ > 0) {
+                return;
+            }
+#ifndef _WIN32
+            h.fd = open((path + LOCK_SUFFIX).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+            if (h.fd < 0) {
+                warning("Could not lock '" + path + "'; carrying on without.");
+                return;
+            }
+            timer t(phase::wait);
+            while (flock(h.fd, LOCK_EX) != 0 && errno == EINTR) {}
+#endif
+        }
+
+        ~lock() {
+            held& h = table()[path];
+            if (--h.depth == 0) {
+#ifndef _WIN32
+                if (h.fd >= 0) {
+                    flock(h.fd, LOCK_UN);
+                    close(h.fd);
+                }
+#endif
+                table().erase(path);
+            }
+        }
+
+        lock(const lock&) = delete;
+        lock& operator=(const lock&) = delete;
+};
+
+// a temporary name beside 'path' for the next generation of it.
+std::string staging(const std::string path) {
+#ifdef _WIN32
+    return path + "." + std::to_string(_getpid()) + ".tmp";
+#else
+    return path + "." + std::to_string(getpid()) + ".tmp";
+#endif
+}
+
+// makes the file at 'staged' the current generation of 'path'. returns whether it did.
+bool promote(const std::string staged, const std::string path) {
+#ifdef _WIN32
+    std::remove(path.c_str()); // windows will not rename over a file, so this is not atomic there
+#endif
+    if (std::rename(staged.c_str(), path.c_str()) != 0) {
+        std::remove(staged.c_str());
+        return false;
+    }
+    return true;
+}
+
+// flushes the directory holding 'path' to the disk, so that a file renamed into it stays there after a crash.
+bool syncDirectory(const std::string path) {
+#ifdef _WIN32
+    return true; // renames are flushed with the file there
+#else
+    int fd = open(fs::absolute(path).parent_path().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    bool synced = fsync(fd) == 0;
+    ::close(fd);
+    return synced;
+#endif
+}
+
+// an istream buffer that reads straight from a file descriptor.
+class fdbuf : public std::streambuf {
+    private:
+        int fd;
+        std::array<char, SINK_SIZE> buffer;
+        std::uintmax_t fetched = 0;
+
+    protected:
+        int_type underflow() override {
+            if (gptr() < egptr()) {
+                return traits_type::to_int_type(*gptr());
+            }
+#ifdef _WIN32
+            long got = _read(fd, buffer.data(), buffer.size());
+#else
+            ssize_t got = ::read(fd, buffer.data(), buffer.size());
+#endif
+            if (got <= 0) {
+                return traits_type::eof();
+            }
+            fetched += got;
+            setg(buffer.data(), buffer.data(), buffer.data() + got);
+            return traits_type::to_int_type(*gptr());
+        }
+
+    public:
+        fdbuf(int fd) : fd(fd) {}
+
+        // bytes handed out so far.
+        std::uintmax_t consumed() const {
+            return fetched - (egptr() - gptr());
+        }
+};
+
+// one generation of the database, opened and pinned with a shared flock() for as long as it is read.
+// the pin only holds off in-place patches, which go ahead on a generation no one has open.
+class snapshot {
+    private:
+        static int opened(const std::string path) {
+#ifdef _WIN32
+            return _open(path.c_str(), _O_RDONLY | _O_BINARY);
+#else
+            int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd >= 0) {
+                timer t(phase::wait);
+                while (flock(fd, LOCK_SH) != 0 && errno == EINTR) {}
+            }
+            return fd;
+#endif
+        }
+
+    public:
+        const int fd;
+
+    private:
+        fdbuf buffer;
+
+    public:
+        std::istream in;
+
+        snapshot(const std::string path) : fd(opened(path)), buffer(fd), in(&buffer) {
+            if (fd < 0) {
+                in.setstate(std::ios::badbit);
+            }
+        }
+
+        ~snapshot() {
+            if (fd >= 0) {
+#ifdef _WIN32
+                _close(fd);
+#else
+                close(fd); // and with it the pin
+#endif
+            }
+        }
+
+        // whether the database could be opened at all.
+        bool good() const {
+            return fd >= 0;
+        }
+
+        // its size in bytes, or 0 if it could not be opened.
+        std::uint64_t size() const {
+#ifdef _WIN32
+            struct _stat64 info;
+            return fd >= 0 && _fstat64(fd, &info) == 0 ? info.st_size : 0;
+#else
+            struct stat info;
+            return fd >= 0 && fstat(fd, &info) == 0 ? info.st_size : 0;
+#endif
+        }
+
+        // bytes of it read so far.
+        std::uintmax_t consumed() const {
+            return buffer.consumed();
+        }
+
+        snapshot(const snapshot&) = delete;
+        snapshot& operator=(const snapshot&) = delete;
+};
+
+/*////////////////*
+//  WORKER POOL  //
+*////////////////*/
+
+// a fixed set of worker threads that split a range of work between them.
+// 'run' blocks until every worker has finished its share.
+class pool {
+    private:
+        std::vector<std::thread> workers;
+        std::mutex lock;
+        std::condition_variable wake;
+        std::condition_variable done;
+        std::function<void(std::size_t, std::size_t)> job;
+        std::size_t size = 0;
+        unsigned generation = 0;
+        unsigned pending = 0;
+        bool stopping = false;
+        bool started = true; // every worker asked for
+
+        void loop(unsigned index) {
+            unsigned seen = 0;
+            while (true) {
+                std::unique_lock<std::mutex> guard(lock);
+                wake.wait(guard, [&] { return stopping || generation != seen; });
+                if (stopping) {
+                    return;
+                }
+                seen = generation;
+                guard.unlock();
+
+                // the calling thread takes share 0, workers take the rest
+                unsigned shares = workers.size() + 1;
+                std::size_t begin = size * (index + 1) / shares;
+                std::size_t end = size * (index + 2) / shares;
+                if (begin < end) {
+                    job(begin, end);
+                }
+
+                guard.lock();
+                if (--pending == 0) {
+                    done.notify_one();
+                }
+            }
+        }
+
+    public:
+        pool(unsigned threads) {
+            try {
+                for (unsigned i = 1; i < threads; i++) {
+                    workers.emplace_back(&pool::loop, this, i - 1);
+                }
+            } catch (const std::system_error&) {
+                started = false; // the work is shared between those that did start
+            }
+        }
+
+        // whether every worker asked for was started.
+        bool good() const {
+            return started;
+        }
+
+        ~pool() {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (auto& w : workers) {
+                w.join();
+            }
+        }
+
+        // calls 'work' with contiguous, non-overlapping [begin, end) ranges covering [0, n).
+        void run(std::size_t n, std::function<void(std::size_t, std::size_t)> work) {
+            if (workers.empty()) {
+                work(0, n);
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                job = work;
+                size = n;
+                pending = workers.size();
+                generation++;
+            }
+            wake.notify_all();
+            std::size_t end = n / (workers.size() + 1);
+            if (end > 0) {
+                work(0, end);
+            }
+            std::unique_lock<std::mutex> guard(lock);
+            done.wait(guard, [&] { return pending == 0; });
+        }
+};
+
+/*/////////////////*
+//  TRANSACTIONS  //
+*/////////////////*/
+
+// commands run against one database in memory, written out together once they are all done.
+// while one is open, every read of the database sees what the commands before have left, and nothing reaches the disk.
+struct transaction {
+    std::string path; // of the database it covers; empty when none is open
+    json pending; // the database as the commands have left it
+    bool loaded = false; // whether 'pending' has been read in yet
+    bool dirty = false; // whether any command has changed it
+
+    // whether the database at 'of' is read and written through the transaction.
+    bool covers(const std::string of) const {
+        return !path.empty() && of == path;
+    }
+};
+
+transaction batch;
+
+/*//////////*
+//  INDEX  //
+*//////////*/
+
+// the sidecar index lets a single item be read, or patched, by its identifier with a handful of small
+// reads and writes, however large the database. it is written alongside the database whenever kial writes
+// it out, and whenever r/readable has to scan the whole file, and trusted only while the database's size,
+// modification time and sampled contents still match.
+// its layout is an indexHeader, then one indexRecord per item, sorted by identifier hash.
+
+// a well-spread 64-bit hash, FNV-1a finished with a murmur mix.
+std::uint64_t hash64(std::string_view data) {
+    std::uint64_t h = 14695981039346656037ull;
+    for (char c : data) {
+        h = (h ^ (unsigned char)c) * 1099511628211ull;
+    }
+    h = (h ^ (h >> 33)) * 0xff51afd7ed558ccdull;
+    h = (h ^ (h >> 33)) * 0xc4ceb9fe1a85ec53ull;
+    return h ^ (h >> 33);
+}
+
+
+struct indexStamp {
+    std::uint64_t size = 0;
+    std::int64_t mtime = 0;
+    std::uint64_t sample = 0; // hash of the first and last INDEX_SAMPLE bytes
+};
+
+struct indexHeader {
+    char magic[8];
+    indexStamp stamp;
+    std::uint64_t slack; // padding written after each item
+    std::uint64_t count;
+    std::uint64_t patches; // in-place patches made since it was written, which need not change the stamp
+};
+
+struct indexRecord {
+    std::uint64_t hash; // of the identifier
+    std::uint64_t begin, end;
+};
+
+// reads 'size' bytes at 'offset' in 'fd' into 'out'. returns whether they were all there.
+bool readAt(int fd, void * out, std::size_t size, std::uint64_t offset) {
+    char * to = static_cast<char *>(out);
+    while (size > 0) {
+#ifdef _WIN32
+        _lseeki64(fd, offset, SEEK_SET);
+        long got = _read(fd, to, size);
+#else
+        ssize_t got = pread(fd, to, size, offset);
+#endif
+        if (got <= 0) {
+            return false;
+        }
+        to += got;
+        offset += got;
+        size -= got;
+    }
+    return true;
+}
+
+// writes all of 'size' bytes from 'in' at 'offset' in 'fd'. returns whether they were.
+bool writeAt(int fd, const void * in, std::size_t size, std::uint64_t offset) {
+    const char * from = static_cast<const char *>(in);
+    while (size > 0) {
+#ifdef _WIN32
+        _lseeki64(fd, offset, SEEK_SET);
+        long put = _write(fd, from, size);
+#else
+        ssize_t put = pwrite(fd, from, size, offset);
+#endif
+        if (put <= 0) {
+            return false;
+        }
+        from += put;
+        offset += put;
+        size -= put;
+    }
+    return true;
+}
+
+// closes a file descriptor when it goes out of scope.
+struct descriptor {
+    int fd;
+
+    descriptor(const std::string path, bool writing = false) {
+#ifdef _WIN32
+        fd = _open(path.c_str(), (writing ? _O_RDWR : _O_RDONLY) | _O_BINARY);
+#else
+        fd = open(path.c_str(), writing ? O_RDWR : O_RDONLY);
+#endif
+    }
+
+    ~descriptor() {
+        if (fd >= 0) {
+#ifdef _WIN32
+            _close(fd);
+#else
+            close(fd);
+#endif
+        }
+    }
+};
+
+// the generation of the database open at 'fd', to compare against an index's stamp.
+indexStamp stampOf(int fd) {
+    indexStamp st;
+#ifdef _WIN32
+    struct _stat64 info;
+    if (fd < 0 || _fstat64(fd, &info) != 0) {
+        return {};
+    }
+    st.mtime = info.st_mtime;
+#else
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        return {};
+    }
+    st.mtime = info.st_mtim.tv_sec * 1000000000ll + info.st_mtim.tv_nsec;
+#endif
+    st.size = info.st_size;
+    std::size_t each = std::min<std::uint64_t>(INDEX_SAMPLE, st.size);
+    std::string sample(each * 2, '\0');
+    if (!readAt(fd, &sample[0], each, 0) || !readAt(fd, &sample[each], each, st.size - each)) {
+        return {};
+    }
+    st.sample = hash64(sample);
+    return st;
+}
+
+bool operator==(const indexStamp& a, const indexStamp& b) {
+    return a.size == b.size && a.mtime == b.mtime && a.sample == b.sample;
+}
+
+// writes the index for the generation 'stamp' of the database at 'path', whose items sit where 'records' say and
+// are each followed by 'slack' bytes of padding. an index that cannot be written is simply not used.
+void writeIndex(const std::string path, std::vector<indexRecord>& records, std::size_t slack, const indexStamp& stamp) {
+    std::sort(records.begin(), records.end(), [](const indexRecord& a, const indexRecord& b) {
+        return a.hash != b.hash ? a.hash < b.hash : a.begin < b.begin;
+    });
+
+    indexHeader header;
+    std::memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+    header.stamp = stamp;
+    header.slack = slack;
+    header.count = records.size();
+    header.patches = 0;
+    // published whole, like the database, so a reader never sees half of one
+    std::string staged = staging(path + INDEX_SUFFIX);
+    std::ofstream out(staged, std::ios::binary);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(indexRecord));
+    out.close();
+    if (!out || !promote(staged, path + INDEX_SUFFIX)) {
+        std::remove(staged.c_str());
+        warning("Could not write the index '" + path + INDEX_SUFFIX + "'.");
+    }
+}
+
+// reads the header of the index open at 'index' into 'header'. returns whether there was one.
+bool readIndexHeader(const descriptor& index, indexHeader& header) {
+    return index.fd >= 0 && readAt(index.fd, &header, sizeof(header), 0)
+            && std::memcmp(header.magic, INDEX_MAGIC, sizeof(header.magic)) == 0;
+}
+
+bool readIndexHeader(const std::string path, indexHeader& header) {
+    return readIndexHeader(descriptor(path + INDEX_SUFFIX), header);
+}
+
+// how many times the generation of the database at 'path' with 'stamp' has been patched in place,
+// as its index counts them. 0 if it has no index of that generation.
+std::uint64_t patchesOf(const std::string path, const indexStamp& stamp) {
+    indexHeader header;
+    return readIndexHeader(path, header) && header.stamp == stamp ? header.patches : 0;
+}
+
+// reads the header of the database's index into 'header'. returns whether the index is there and
+// is for the generation of the database open at 'db'.
+bool current(int db, const descriptor& index, indexHeader& header) {
+    return readIndexHeader(index, header) && stampOf(db) == header.stamp;
+}
+
+// the padding the database at 'path' was last written with, if its index says.
+std::size_t slackOf(const std::string path) {
+    indexHeader header;
+    return readIndexHeader(path, header) ? header.slack : 0;
+}
+
+// the outcome of looking an item up in the index.
+enum class lookup { unindexed, absent, found };
+
+// which record of the index an item was found through.
+struct entry {
+    indexHeader header;
+    std::uint64_t position;
+    indexRecord record;
+};
+
+// finds the item called 'identifier' through the database's index, reading only that item, and hands it to 'visit'.
+// it is freed again before this returns. returns unindexed if there is no usable index, in which case the database must be scanned.
+template<typename F>
+lookup indexed(const std::string path, const std::string& identifier, F visit, entry * at = nullptr) {
+    if (batch.covers(path)) { // the index only knows the database as it was
+        return lookup::unindexed;
+    }
+    // the generation first, so the index is at least as new as it
+    snapshot db(path);
+    descriptor index(path + INDEX_SUFFIX);
+    indexHeader header;
+    if (!current(db.fd, index, header)) {
+        return lookup::unindexed;
+    }
+
+    // binary search for the first record with the identifier's hash
+    std::uint64_t hash = hash64(identifier);
+    std::uint64_t low = 0, high = header.count;
+    indexRecord r;
+    while (low < high) {
+        std::uint64_t mid = low + (high - low) / 2;
+        if (!readAt(index.fd, &r, sizeof(r), sizeof(header) + mid * sizeof(r))) {
+            return lookup::unindexed;
+        }
+        if (r.hash < hash) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    profile.current.read += sizeof(header) + sizeof(r) * (64 - __builtin_clzll(header.count | 1));
+
+    // a hash may be shared, so each item with it is read until one really is the item
+    for (; low < header.count; low++) {
+        if (!readAt(index.fd, &r, sizeof(r), sizeof(header) + low * sizeof(r)) || r.hash != hash) {
+            break;
+        }
+        std::string bytes(r.end - r.begin, '\0');
+        if (r.end > header.stamp.size || r.end < r.begin || !readAt(db.fd, &bytes[0], bytes.size(), r.begin)) {
+            return lookup::unindexed;
+        }
+        profile.current.read += bytes.size();
+        timer t(phase::parse);
+        arena::heap unarena;
+        try {
+            json j = json::parse(bytes);
+            auto id = j.find("identifier");
+            if (id != j.end() && *id == identifier) {
+                profile.current.items++;
+                if (at != nullptr) {
+                    *at = {header, low, r};
+                }
+                visit(j);
+                return lookup::found;
+            }
+        } catch (const json::exception&) { // the index is off somehow
+            return lookup::unindexed;
+        }
+    }
+    return lookup::absent;
+}
+
+// an item as it is laid out within the database file, indented as one element of the array.
+std::string itemText(const json& item) {
+    std::string text = item.dump(4);
+    std::string shifted;
+    shifted.reserve(text.size() + text.size() / 8);
+    // strings never hold a raw newline, so every one starts a line
+    for (char c : text) {
+        shifted += c;
+        if (c == '\n') {
+            shifted += "    ";
+        }
+    }
+    return shifted;
+}
+
+// writes 'text', an item laid out by itemText, over that item in the database, where the index says it is. if it no longer fits in its
+// span and the padding after it, its old span becomes a null and it is moved to the end of the array.
+// this changes the current generation in place, so it is only done while no reader has that generation open.
+// returns whether the item was written; if not, the database reads as it did before.
+bool patch(const std::string path, std::string text, entry& at) {
+    lock guard(path);
+    timer t(phase::serialize);
+    descriptor db(path, true);
+    descriptor index(path + INDEX_SUFFIX, true);
+    if (db.fd < 0 || index.fd < 0) {
+        return false;
+    }
+#ifndef _WIN32
+    // readers pin what they read, so any pin means a new generation is needed instead
+    if (flock(db.fd, LOCK_EX | LOCK_NB) != 0) {
+        return false;
+    }
+    if (!(stampOf(db.fd) == at.header.stamp)) { // changed since it was looked up
+        return false;
+    }
+#endif
+    std::uint64_t begin = at.record.begin, old = at.record.end - at.record.begin;
+
+    // how much room there is: the old span, and as much padding after it as is needed
+    std::uint64_t room = old;
+    if (text.size() > old) {
+        std::string after(std::min<std::uint64_t>(text.size() - old, at.header.stamp.size - at.record.end), '\0');
+        if (!readAt(db.fd, &after[0], after.size(), at.record.end)) {
+            return false;
+        }
+        room += std::find_if_not(after.begin(), after.end(), [](char c) { return std::isspace((unsigned char)c); }) - after.begin();
+    }
+
+    if (text.size() <= room) {
+        // over the old span, blanking whatever it leaves behind
+        std::uint64_t end = begin + text.size();
+        text.append(std::max<std::uint64_t>(old, text.size()) - text.size(), ' ');
+        if (!writeAt(db.fd, text.data(), text.size(), begin)) {
+            return false;
+        }
+        profile.current.written += text.size();
+        at.record.end = end;
+    } else {
+        // find where the array closes, past any padding after the last item
+        std::uint64_t size = at.header.stamp.size;
+        std::string tail(std::min<std::uint64_t>(size, INDEX_SAMPLE), '\0');
+        if (!readAt(db.fd, &tail[0], tail.size(), size - tail.size())) {
+            return false;
+        }
+        std::size_t close = tail.rfind(']');
+        std::size_t last = close == std::string::npos ? std::string::npos : tail.find_last_not_of(" \t\r\n", close - 1);
+        if (last == std::string::npos) {
+            return false;
+        }
+        std::uint64_t from = size - tail.size() + last + 1;
+
+        // the copy goes in first, closing the array after it, and only then does the old span become
+        // a null, padded out to its old size; a failure in between would otherwise lose the item
+        std::string moved = ",\n    " + text + std::string(at.header.slack, ' ') + "\n]\n";
+        if (!writeAt(db.fd, moved.data(), moved.size(), from)) {
+            return false;
+        }
+        std::string tombstone = "null" + std::string(old - 4, ' ');
+        if (!writeAt(db.fd, tombstone.data(), tombstone.size(), begin)) {
+            // put the old ending back, blanking whatever of the copy ran past it
+            std::string blank(std::max<std::uint64_t>(from + moved.size(), size) - size, ' ');
+            writeAt(db.fd, tail.data(), tail.size(), size - tail.size());
+            writeAt(db.fd, blank.data(), blank.size(), size);
+            return false;
+        }
+        profile.current.written += tombstone.size() + moved.size();
+        at.record.begin = from + 6;
+        at.record.end = at.record.begin + text.size();
+    }
+
+    // the record moves with the item, and the stamp with the database. a patch may leave the size,
+    // modification time and samples just as they were, so it is counted too, for snapshots to tell
+    at.header.stamp = stampOf(db.fd);
+    at.header.patches++;
+    if (!writeAt(index.fd, &at.record, sizeof(at.record), sizeof(at.header) + at.position * sizeof(at.record))
+            || !writeAt(index.fd, &at.header, sizeof(at.header), 0)) {
+        warning("Could not update the index '" + path + INDEX_SUFFIX + "'.");
+    }
+    return true;
+}
+
+/*///////////////*
+//  READ/WRITE  //
+*///////////////*/
+
+// used for reading json in conjunction with parameters.
+json read(parameter& parent, const std::string path) {
+    if (batch.covers(path) && batch.loaded) {
+        profile.current.items += batch.pending.size();
+        return batch.pending;
+    }
+
+    // read json data
+    timer t(phase::parse);
+    snapshot db(path);
+    json jf;
+    try {
+        jf = json::parse(db.in);
+        profile.current.read += db.consumed();
+    } catch (const json::exception&) { // catch json errors
+        return fatal(parent.prettify() + JSON_ERROR);
+    }
+    
+    // make sure is array
+    if (!jf.is_array()) {
+        return fatal(parent.prettify() + JSON_ERROR);
+    }
+
+    // drop the nulls left behind by patched items that had to move
+    auto& items = jf.get_ref<json::array_t&>();
+    items.erase(std::remove_if(items.begin(), items.end(), [](const json& j) { return j.is_null(); }), items.end());
+
+    profile.current.items += jf.size();
+    if (batch.covers(path)) {
+        batch.pending = jf;
+        batch.loaded = true;
+    }
+    return jf;
+}
+
+// the database file for 'value', with each item followed by 'slack' bytes of padding.
+// where each item was laid out goes into 'records'.
+std::string layout(const json& value, std::size_t slack, std::vector<indexRecord>& records) {
+    if (!value.is_array()) {
+        return value.dump(4) + "\n";
+    }
+    if (value.empty()) {
+        return "[]\n";
+    }
+    std::string padding(slack, ' ');
+    std::string out = "[\n";
+    for (std::size_t i = 0; i < value.size(); i++) {
+        const json& item = value[i];
+        std::string text = itemText(item);
+        out += "    ";
+        auto id = item.find("identifier");
+        records.push_back({hash64(id != item.end() && id->is_string() ? id->get_ref<const std::string&>() : ""), out.size(), out.size() + text.size()});
+        out += text;
+        out += padding;
+        out += i + 1 < value.size() ? ",\n" : "\n";
+    }
+    out += "]\n";
+    return out;
+}
+
+// used for writing json in conjunction with parameters.
+// each item is followed by the database's slack, and where it was written goes into the index.
+// the database is written out whole beside the old one and then takes its place, as a new generation.
+// if 'durable', it is flushed to the disk before it does, and its directory once it has.
+void write(parameter& parent, const std::string path, json& value, bool durable = false) {
+    if (batch.covers(path)) { // written once the transaction is done, and 'value' is done with
+        batch.pending = std::move(value);
+        batch.loaded = batch.dirty = true;
+        return;
+    }
+
+    lock guard(path);
+    // write to file
+    timer t(phase::serialize);
+    std::size_t slack = config.slack != SIZE_MAX ? config.slack : slackOf(path);
+    std::vector<indexRecord> records;
+    std::string text = layout(value, slack, records);
+    std::string staged = staging(path);
+    indexStamp stamp;
+    {
+        std::ofstream out(staged, std::ios::binary);
+        out.write(text.data(), text.size());
+        out.close();
+        descriptor written(staged, true);
+#ifdef _WIN32
+        bool synced = !durable || _commit(written.fd) == 0;
+#else
+        bool synced = !durable || fsync(written.fd) == 0;
+#endif
+        stamp = stampOf(written.fd);
+        if (!out || !synced || !promote(staged, path) || (durable && !syncDirectory(path))) {
+            std::remove(staged.c_str());
+            fatal(parent.prettify() + WRITE_ERROR);
+            return;
+        }
+    }
+    profile.current.written += text.size();
+    if (value.is_array()) {
+        writeIndex(path, records, slack, stamp);
+    }
+}
+
+// thrown from inside the parser to stop reading once a visitor is satisfied.
+struct stopReading {};
+
+// streams the database's items one at a time as they are parsed, never holding the whole array.
+// 'visit' returns false to stop, at which point the rest of the file is not read.
+// this one reads the generation already open as 'db'.
+void stream(parameter& parent, snapshot& db, std::function<bool(const json&)> visit) {
+    timer t(phase::parse);
+    // items are thrown away as soon as they are visited, so the arena would only hoard them
+    arena::heap unarena;
+    bool first = true;
+    try {
+        // only the emptied husk of the array is left once parsing is done
+        json husk = json::parse(db.in, [&](int depth, json::parse_event_t event, json& parsed) {
+            // make sure is array
+            if (first && event != json::parse_event_t::array_start) {
+                throw json::other_error::create(501, "not an array", &parsed);
+            }
+            first = false;
+            if (depth == 1 && event == json::parse_event_t::object_end) {
+                profile.current.items++;
+                if (!visit(parsed)) {
+                    throw stopReading();
+                }
+                return false; // done with it, so don't keep it
+            }
+            return true;
+        });
+    } catch (const stopReading&) {
+        // finished early
+    } catch (const json::exception&) { // catch json errors
+        fatal(parent.prettify() + JSON_ERROR);
+    }
+    profile.current.read += db.consumed();
+}
+
+void stream(parameter& parent, const std::string path, std::function<bool(const json&)> visit) {
+    if (batch.covers(path)) {
+        timer t(phase::parse);
+        arena::heap unarena;
+        if (!batch.loaded) {
+            read(parent, path);
+        }
+        for (const json& item : batch.pending) {
+            if (!visit(item)) {
+                break;
+            }
+        }
+        return;
+    }
+    snapshot db(path);
+    stream(parent, db, visit);
+}
+
+// where an item sits in the database file, and what it is called.
+struct span {
+    std::size_t begin, end;
+    std::string identifier;
+};
+
+// the database's outline: the file as it is, and every item's span within it,
+// found without building any of them. items are only parsed once something asks for them.
+struct outline {
+    std::string text;
+    std::vector<span> items;
+    indexStamp stamp; // of the generation it was read from
+
+    // parses the item at 'at' and hands it to 'visit', freeing it again before this returns.
+    template<typename F>
+    void parse(std::size_t at, F visit) const {
+        arena::heap unarena; // one at a time, so not worth hoarding
+        json item;
+        {
+            timer t(phase::parse);
+            item = json::parse(text.data() + items[at].begin, text.data() + items[at].end);
+        }
+        visit(item);
+    }
+};
+
+// reads the database at 'path' and scans it for where each item starts and ends, and for each
+// identifier. only the structure is checked; the items themselves are checked as they are parsed.
+outline scan(parameter& parent, const std::string path) {
+    outline o;
+    if (batch.covers(path)) {
+        // laid out just as it will be written, with no generation to stamp
+        std::vector<indexRecord> records;
+        if (!batch.loaded) {
+            read(parent, path);
+        }
+        o.text = layout(batch.pending, 0, records);
+    } else {
+        timer t(phase::parse);
+        snapshot db(path);
+        o.stamp = stampOf(db.fd);
+        o.text.resize(o.stamp.size);
+        if (!db.good() || !readAt(db.fd, &o.text[0], o.text.size(), 0)) {
+            fatal(parent.prettify() + JSON_ERROR);
+            return {};
+        }
+        profile.current.read += o.text.size();
+    }
+
+    timer t(phase::scan);
+    // the only bytes that matter to the outline
+    static const std::array<bool, 256> structural = [] {
+        std::array<bool, 256> is {};
+        for (unsigned char c : std::string("\"[]{},")) {
+            is[c] = true;
+        }
+        return is;
+    }();
+    const std::string& text = o.text;
+    int depth = 0;
+    bool started = false;
+    bool key = false; // the next string in the item is a key
+    bool named = false; // the next string in the item is its identifier
+    bool identified = false;
+    std::size_t begin = 0;
+    std::string identifier;
+    for (std::size_t i = 0; i < text.size(); i++) {
+        char c = text[i];
+        if (!structural[(unsigned char)c]) {
+            continue;
+        }
+        switch (c) {
+            case '"': {
+                // skip to the closing quote, past any escaped ones
+                std::size_t close = text.find_first_of("\"\\", i + 1);
+                while (close != std::string::npos && text[close] == '\\') {
+                    close = text.find_first_of("\"\\", close + 2);
+                }
+                if (close == std::string::npos) {
+                    fatal(parent.prettify() + JSON_ERROR);
+                    return {};
+                }
+                if (depth == 2) {
+                    std::string_view contents(text.data() + i + 1, close - i - 1);
+                    if (key) {
+                        named = contents == "identifier";
+                        key = false;
+                    } else if (named) {
+                        // escapes are rare in identifiers, so only then is the parser needed
+                        identifier = contents.find('\\') == std::string_view::npos ? std::string(contents)
+                                : json::parse(text.data() + i, text.data() + close + 1).get<std::string>();
+                        identified = true;
+                        named = false;
+                    }
+                }
+                i = close;
+                break;
+            }
+            case '[':
+            case '{':
+                depth++;
+                if (depth == 1 && (c != '[' || started)) {
+                    fatal(parent.prettify() + JSON_ERROR);
+                    return {};
+                } else if (depth == 2) {
+                    if (c != '{') {
+                        fatal(parent.prettify() + JSON_ERROR);
+                        return {};
+                    }
+                    begin = i;
+                    key = true;
+                    identified = false;
+                }
+                started = true;
+                break;
+            case ']':
+            case '}':
+                if (depth == 2) {
+                    if (!identified) {
+                        fatal(parent.prettify() + JSON_ERROR);
+                        return {};
+                    }
+                    o.items.push_back({begin, i + 1, std::move(identifier)});
+                    identifier.clear();
+                }
+                depth--;
+                if (depth < 0) {
+                    fatal(parent.prettify() + JSON_ERROR);
+                    return {};
+                }
+                break;
+            case ',':
+                if (depth == 2) {
+                    key = true;
+                    named = false;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    if (depth != 0 || !started) {
+        fatal(parent.prettify() + JSON_ERROR);
+        return {};
+    }
+    profile.current.items += o.items.size();
+    return o;
+}
+
+/*////////////*
+//  COLUMNS  //
+*////////////*/
+
+// a run of T, either built up in memory or borrowed as it is from a mapped snapshot (see CACHE).
+// borrowed runs are only read; the first change copies one into memory.
+template<typename T>
+class slab {
+    private:
+        std::vector<T> owned;
+        const T * borrowed = nullptr;
+        std::size_t n = 0;
+
+    public:
+        void borrow(const T * first, std::size_t count) {
+            owned.clear();
+            borrowed = first;
+            n = count;
+        }
+
+        // the run, ready to be changed.
+        std::vector<T>& edit() {
+            if (borrowed != nullptr) {
+                owned.assign(borrowed, borrowed + n);
+                borrowed = nullptr;
+            }
+            return owned;
+        }
+
+        const T * data() const {
+            return borrowed != nullptr ? borrowed : owned.data();
+        }
+
+        std::size_t size() const {
+            return borrowed != nullptr ? n : owned.size();
+        }
+
+        const T& operator[](std::size_t at) const {
+            return data()[at];
+        }
+
+        const T * begin() const {
+            return data();
+        }
+
+        const T * end() const {
+            return data() + size();
+        }
+};
+
+// one bit per item id.
+class bitmap {
+    private:
+        slab<std::uint64_t> words;
+
+    public:
+        // the bits themselves, 64 ids to a word.
+        slab<std::uint64_t>& raw() {
+            return words;
+        }
+
+        const slab<std::uint64_t>& raw() const {
+            return words;
+        }
+
+        void set(std::size_t id) {
+            std::vector<std::uint64_t>& w = words.edit();
+            if (id / 64 >= w.size()) {
+                w.resize(id / 64 + 1);
+            }
+            w[id / 64] |= 1ull << (id % 64);
+        }
+
+        void reset(std::size_t id) {
+            if (id / 64 < words.size()) {
+                words.edit()[id / 64] &= ~(1ull << (id % 64));
+            }
+        }
+
+        bool test(std::size_t id) const {
+            return id / 64 < words.size() && (words[id / 64] >> (id % 64)) & 1;
+        }
+
+        // sets every bit that is set in 'other'.
+        void merge(const bitmap& other) {
+            std::vector<std::uint64_t>& w = words.edit();
+            if (other.words.size() > w.size()) {
+                w.resize(other.words.size());
+            }
+            for (std::size_t at = 0; at < other.words.size(); at++) {
+                w[at] |= other.words[at];
+            }
+        }
+
+        std::size_t count() const {
+            std::size_t n = 0;
+            for (auto w : words) {
+                n += __builtin_popcountll(w);
+            }
+            return n;
+        }
+
+        // calls 'f' with each set id, in order.
+        template<typename F>
+        void each(F f) const {
+            const std::uint64_t * w = words.data();
+            for (std::size_t at = 0; at < words.size(); at++) {
+                for (std::uint64_t bits = w[at]; bits != 0; bits &= bits - 1) {
+                    f(at * 64 + __builtin_ctzll(bits));
+                }
+            }
+        }
+};
+
+// the length of 'value' once dumped as a JSON string, quotes and escapes included.
+std::size_t dumpedSize(std::string_view value) {
+    std::size_t n = 2;
+    for (unsigned char c : value) {
+        if (c == '"' || c == '\\' || c == '\b' || c == '\f' || c == '\n' || c == '\r' || c == '\t') {
+            n += 2;
+        } else if (c < 0x20) {
+            n += 6; // \u00XX
+        } else {
+            n += 1;
+        }
+    }
+    return n;
+}
+
+// every key name seen, each spelled out once and known by its number from then on,
+// so that keys are compared and looked up as integers.
+class symbols {
+    private:
+        std::deque<std::string> spellings; // a deque, so the views below stay put
+        std::unordered_map<std::string_view, std::uint32_t> numbers;
+
+    public:
+        static constexpr std::uint32_t none = UINT32_MAX;
+
+        std::uint32_t intern(std::string_view name) {
+            auto at = numbers.find(name);
+            if (at != numbers.end()) {
+                return at->second;
+            }
+            std::uint32_t symbol = spellings.size();
+            spellings.emplace_back(name);
+            numbers.emplace(spellings.back(), symbol);
+            return symbol;
+        }
+
+        // the number of 'name', or none if it has never been interned.
+        std::uint32_t find(std::string_view name) const {
+            auto at = numbers.find(name);
+            return at == numbers.end() ? none : at->second;
+        }
+
+        const std::string& name(std::uint32_t symbol) const {
+            return spellings[symbol];
+        }
+
+        std::size_t size() const {
+            return spellings.size();
+        }
+};
+
+// one key's values across every item, indexed by item id.
+class column {
+    public:
+        // one item's value. its text is a string's contents, or the JSON of anything else.
+        struct cell {
+            json::value_t type = json::value_t::null;
+            bool escaped = false; // a string that JSON would escape
+            std::uint32_t size = 0;
+            std::size_t start = 0; // into 'text'
+            union {
+                bool boolean;
+                std::int64_t integer;
+                std::uint64_t unsign;
+                double decimal;
+            } number {};
+        };
+
+        bitmap present;
+        slab<cell> cells; // only meaningful where 'present'
+        slab<char> text; // every value's text, back to back
+
+        void set(std::size_t id, const json& value) {
+            std::vector<cell>& all = cells.edit();
+            std::vector<char>& t = text.edit();
+            if (id >= all.size()) {
+                all.resize(id + 1);
+            }
+            cell& c = all[id];
+            c.type = value.type();
+            c.start = t.size();
+            switch (c.type) {
+                case json::value_t::boolean: c.number.boolean = value.get<bool>(); break;
+                case json::value_t::number_integer: c.number.integer = value.get<std::int64_t>(); break;
+                case json::value_t::number_unsigned: c.number.unsign = value.get<std::uint64_t>(); break;
+                case json::value_t::number_float: c.number.decimal = value.get<double>(); break;
+                default: break;
+            }
+            if (c.type == json::value_t::string) {
+                const std::string& contents = value.get_ref<const std::string&>();
+                c.escaped = dumpedSize(contents) != contents.size() + 2;
+                t.insert(t.end(), contents.begin(), contents.end());
+            } else {
+                std::string dumped = value.dump();
+                t.insert(t.end(), dumped.begin(), dumped.end());
+            }
+            c.size = t.size() - c.start;
+            present.set(id);
+        }
+
+        std::string_view view(std::size_t id) const {
+            return std::string_view(text.data(), text.size()).substr(cells[id].start, cells[id].size);
+        }
+
+        // the text as it appears in the file, which for strings is without their quotes.
+        std::string_view dumped(std::size_t id, std::string& scratch) const {
+            if (!cells[id].escaped) {
+                return view(id);
+            }
+            scratch = json(view(id)).dump();
+            return std::string_view(scratch).substr(1, scratch.size() - 2);
+        }
+
+        // the value as JSON again.
+        json get(std::size_t id) const {
+            const cell& c = cells[id];
+            switch (c.type) {
+                case json::value_t::boolean: return c.number.boolean;
+                case json::value_t::number_integer: return c.number.integer;
+                case json::value_t::number_unsigned: return c.number.unsign;
+                case json::value_t::number_float: return c.number.decimal;
+                case json::value_t::string: return std::string(view(id));
+                case json::value_t::array:
+                case json::value_t::object: return json::parse(view(id));
+                default: return nullptr;
+            }
+        }
+};
+
+// the database held column by column: items are numbered densely in file order, their identifiers
+// kept in one column and every other key in a column of its own. it is built straight from the file,
+// so searching, counting and summarising scan flat arrays instead of walking a tree per item.
+class store {
+    public:
+        slab<char> names; // every identifier, back to back
+        slab<std::uint64_t> ends; // where each identifier in 'names' ends
+        symbols keys;
+        std::vector<column> columns; // by key symbol
+        std::vector<std::uint32_t> order; // key symbols, sorted by name as items keep them
+        slab<std::uint64_t> table; // identifiers by hash, when borrowed from a snapshot (see CACHE)
+        std::shared_ptr<const void> image; // the snapshot borrowed from, if any
+
+        std::size_t size() const {
+            return ends.size();
+        }
+
+        // the id of the first item called 'identifier', or size() if there is none.
+        std::size_t find(std::string_view identifier) const {
+            if (table.size() == 0) {
+                for (std::size_t id = 0; id < size(); id++) {
+                    if (this->identifier(id) == identifier) {
+                        return id;
+                    }
+                }
+                return size();
+            }
+            for (std::size_t at = hash64(identifier) & (table.size() - 1); table[at] != 0; at = (at + 1) & (table.size() - 1)) {
+                if (table[at] <= size() && this->identifier(table[at] - 1) == identifier) {
+                    return table[at] - 1;
+                }
+            }
+            return size();
+        }
+
+        std::string_view identifier(std::size_t id) const {
+            std::size_t start = id == 0 ? 0 : ends[id - 1];
+            return std::string_view(names.data(), names.size()).substr(start, ends[id] - start);
+        }
+
+        void append(const json& j) {
+            std::size_t id = size();
+            const std::string& identifier = j["identifier"].get_ref<const std::string&>();
+            std::vector<char>& n = names.edit();
+            n.insert(n.end(), identifier.begin(), identifier.end());
+            ends.edit().push_back(n.size());
+            for (auto& kav : j.items()) {
+                if (kav.key() == "identifier") {
+                    continue;
+                }
+                std::uint32_t key = keys.intern(kav.key());
+                if (key == columns.size()) { // new
+                    columns.emplace_back();
+                    order.insert(std::upper_bound(order.begin(), order.end(), key, [&](std::uint32_t a, std::uint32_t b) {
+                        return keys.name(a) < keys.name(b);
+                    }), key);
+                }
+                columns[key].set(id, kav.value());
+            }
+        }
+
+        // the item as JSON again.
+        json item(std::size_t id) const {
+            json j = json::object();
+            j["identifier"] = identifier(id);
+            for (std::uint32_t key : order) {
+                if (columns[key].present.test(id)) {
+                    j[keys.name(key)] = columns[key].get(id);
+                }
+            }
+            return j;
+        }
+
+        // the whole database as JSON again, ready to be written out.
+        json array() const {
+            json a = json::array();
+            for (std::size_t id = 0; id < size(); id++) {
+                a.push_back(item(id));
+            }
+            return a;
+        }
+};
+
+/*//////////*
+//  CACHE  //
+*//////////*/
+
+// the columns of a database are kept between runs as a binary snapshot under $XDG_CACHE_HOME/kial (or ~/.cache/kial),
+// named for the database's path. a snapshot is only used while the database is still the very file it was
+// taken from: the same path, inode, size, modification time and sampled contents, and patched in place as many
+// times since. anything else rebuilds it.
+//
+// snapshots are used where they lie: one is mapped, and the columns borrow their arrays straight from the
+// mapping, so opening one parses and copies nothing: it only checks the identifiers' ends and the cells against
+// what they point into. every part of it is found by its offset from the start of the file, after the header: the path,
+// the identifiers' text and where each ends, a hash table of the identifiers, the key order, then each key's
+// name, bitmap, cells and text, and last a record per key of where its parts are.
+
+static_assert(std::is_trivially_copyable<column::cell>::value, "cells are saved as they are in memory");
+
+// a part of a snapshot: how far into it the part starts, and how many elements it holds.
+struct extent {
+    std::uint64_t offset = 0;
+    std::uint64_t count = 0;
+};
+
+struct cacheHeader {
+    char magic[8];
+    std::uint64_t inode;
+    indexStamp stamp;
+    std::uint64_t patches; // as counted by the database's index
+    std::uint64_t size; // of the whole snapshot
+    std::uint32_t cellSize; // cells are laid out as the build that saved them lays them out
+    std::uint32_t keys;
+    extent path, names, ends, table, order, columns;
+};
+
+struct cacheColumn {
+    extent name, words, cells, text;
+};
+
+// the inode of the file open at 'fd', or 0 where there are none.
+std::uint64_t inodeOf(int fd) {
+#ifdef _WIN32
+    return 0;
+#else
+    struct stat info;
+    return fstat(fd, &info) == 0 ? info.st_ino : 0;
+#endif
+}
+
+// where the snapshot of the database at 'path' is kept, or "" if there is nowhere to keep it.
+std::string cachePath(const std::string path) {
+    const char * xdg = std::getenv("XDG_CACHE_HOME");
+    const char * home = std::getenv("HOME");
+    std::string dir;
+    if (xdg != nullptr && *xdg != '\0') {
+        dir = std::string(xdg) + "/kial";
+    } else if (home != nullptr && *home != '\0') {
+        dir = std::string(home) + "/.cache/kial";
+    } else {
+        return "";
+    }
+    char name[32];
+    std::snprintf(name, sizeof(name), "/%016llx.snap", (unsigned long long)hash64(fs::absolute(path).string()));
+    return dir + name;
+}
+
+// lays out the parts of a snapshot one after another, each aligned for what it holds, then writes them in that order.
+class cacheWriter {
+    private:
+        struct part {
+            const char * data;
+            std::uint64_t offset;
+            std::uint64_t size;
+        };
+        std::vector<part> parts;
+
+    public:
+        std::uint64_t end = sizeof(cacheHeader);
+
+        template<typename T>
+        extent place(const T * data, std::size_t count) {
+            end = (end + alignof(T) - 1) / alignof(T) * alignof(T);
+            extent e {end, count};
+            parts.push_back({reinterpret_cast<const char *>(data), end, count * sizeof(T)});
+            end += count * sizeof(T);
+            return e;
+        }
+
+        extent place(std::string_view text) {
+            return place(text.data(), text.size());
+        }
+
+        bool write(std::ostream& out, const cacheHeader& header) const {
+            static const char zeros[alignof(std::max_align_t)] = {};
+            out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            std::uint64_t at = sizeof(header);
+            for (const part& p : parts) {
+                out.write(zeros, p.offset - at);
+                out.write(p.data, p.size);
+                at = p.offset + p.size;
+            }
+            return bool(out);
+        }
+};
+
+// writes 'db' as the snapshot of the database at 'path', which is the generation with 'inode' and 'stamp'.
+// a snapshot that cannot be written is simply not used.
+void save(const std::string cache, const std::string path, std::uint64_t inode, const indexStamp& stamp, const store& db) {
+    cacheHeader header {};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.inode = inode;
+    header.stamp = stamp;
+    header.patches = patchesOf(path, stamp);
+    header.cellSize = sizeof(column::cell);
+    header.keys = db.keys.size();
+
+    // identifiers hashed into twice as many slots as there are items, holding their id + 1, or 0 if empty
+    std::size_t slots = 1;
+    while (slots < db.size() * 2) {
+        slots *= 2;
+    }
+    std::vector<std::uint64_t> table(db.size() > 0 ? slots : 0);
+    for (std::size_t id = 0; id < db.size(); id++) {
+        std::string_view identifier = db.identifier(id);
+        std::size_t at = hash64(identifier) & (slots - 1);
+        while (table[at] != 0 && db.identifier(table[at] - 1) != identifier) {
+            at = (at + 1) & (slots - 1);
+        }
+        if (table[at] == 0) { // the first of the same name is the one found
+            table[at] = id + 1;
+        }
+    }
+
+    std::string absolute = fs::absolute(path).string();
+    cacheWriter w;
+    header.path = w.place(absolute);
+    header.names = w.place(db.names.data(), db.names.size());
+    header.ends = w.place(db.ends.data(), db.ends.size());
+    header.table = w.place(table.data(), table.size());
+    header.order = w.place(db.order.data(), db.order.size());
+    std::vector<cacheColumn> columns;
+    for (std::uint32_t key = 0; key < db.keys.size(); key++) {
+        const column& col = db.columns[key];
+        columns.push_back({w.place(db.keys.name(key)), w.place(col.present.raw().data(), col.present.raw().size()),
+                w.place(col.cells.data(), col.cells.size()), w.place(col.text.data(), col.text.size())});
+    }
+    header.columns = w.place(columns.data(), columns.size());
+    header.size = w.end;
+
+    std::error_code failed;
+    fs::create_directories(fs::path(cache).parent_path(), failed);
+    std::string staged = staging(cache);
+    std::ofstream file(staged, std::ios::binary);
+    bool written = w.write(file, header);
+    file.close();
+    if (failed || !written || !file || !promote(staged, cache)) {
+        std::remove(staged.c_str());
+        warning("Could not write the snapshot '" + cache + "'.");
+    }
+}
+
+// a snapshot mapped into memory, or read into it where files cannot be mapped.
+class cacheImage {
+    private:
+        const char * base = nullptr;
+        std::uint64_t size = 0;
+
+    public:
+        std::shared_ptr<const void> mapping; // unmapped once nothing borrows from it any more
+
+        cacheImage(const std::string cache) {
+#ifdef _WIN32
+            std::ifstream file(cache, std::ios::binary);
+            std::error_code failed;
+            std::uint64_t n = fs::file_size(cache, failed);
+            std::shared_ptr<char> copy(new char[n + 1], std::default_delete<char[]>());
+            if (failed || !file || !file.read(copy.get(), n)) {
+                return;
+            }
+            base = copy.get();
+            size = n;
+            mapping = copy;
+#else
+            int fd = open(cache.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                return;
+            }
+            struct stat info;
+            if (fstat(fd, &info) == 0 && info.st_size > 0) {
+                void * at = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+                if (at != MAP_FAILED) {
+                    std::uint64_t n = info.st_size;
+                    base = static_cast<const char *>(at);
+                    size = n;
+                    mapping = std::shared_ptr<const void>(at, [n](const void * p) {
+                        munmap(const_cast<void *>(p), n);
+                    });
+                }
+            }
+            ::close(fd); // the mapping outlives the descriptor
+#endif
+        }
+
+        // the header, if there is room for one.
+        const cacheHeader * header() const {
+            return size >= sizeof(cacheHeader) ? reinterpret_cast<const cacheHeader *>(base) : nullptr;
+        }
+
+        // the elements of 'e', or nullptr if it does not lie within the snapshot.
+        template<typename T>
+        const T * at(const extent& e) const {
+            if (e.offset % alignof(T) != 0 || e.offset > size || e.count > (size - e.offset) / sizeof(T)) {
+                return nullptr;
+            }
+            return reinterpret_cast<const T *>(base + e.offset);
+        }
+
+        // lends 'e' to 'into'. false if it does not lie within the snapshot.
+        template<typename T>
+        bool lend(slab<T>& into, const extent& e) const {
+            const T * first = at<T>(e);
+            if (first == nullptr) {
+                return false;
+            }
+            into.borrow(first, e.count);
+            return true;
+        }
+
+        std::string_view text(const extent& e) const {
+            const char * first = at<char>(e);
+            return first != nullptr ? std::string_view(first, e.count) : std::string_view();
+        }
+};
+
+// whether 'col', as borrowed from a snapshot, only marks items that it has cells for, only has cells for
+// items below 'items', and only points its cells at text it holds.
+bool sound(const column& col, std::size_t items) {
+    std::size_t cells = col.cells.size();
+    const slab<std::uint64_t>& words = col.present.raw();
+    if (cells > items || words.size() > (cells + 63) / 64) {
+        return false;
+    }
+    if (cells % 64 != 0 && words.size() == (cells + 63) / 64 && words[words.size() - 1] >> (cells % 64) != 0) {
+        return false;
+    }
+    for (const column::cell& c : col.cells) {
+        if (c.start > col.text.size() || c.size > col.text.size() - c.start) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// borrows 'db' from the snapshot of the database at 'path', if there is one of the generation with 'inode' and 'stamp'.
+// nothing is parsed or copied, but every array that is indexed by another is checked against it first,
+// so that a snapshot cut short or saved by another build is passed over rather than read out of bounds.
+bool restore(const std::string cache, const std::string path, std::uint64_t inode, const indexStamp& stamp, store& db) {
+    cacheImage image(cache);
+    const cacheHeader * h = image.header();
+    if (h == nullptr || std::memcmp(h->magic, CACHE_MAGIC, sizeof(h->magic)) != 0 || h->inode != inode
+            || !(h->stamp == stamp) || h->patches != patchesOf(path, stamp) || h->cellSize != sizeof(column::cell) || image.text(h->path) != fs::absolute(path).string()) {
+        return false;
+    }
+
+    store s;
+    const cacheColumn * columns = image.at<cacheColumn>(h->columns);
+    const std::uint32_t * order = image.at<std::uint32_t>(h->order);
+    bool ok = columns != nullptr && order != nullptr && h->columns.count == h->keys
+            && image.lend(s.names, h->names) && image.lend(s.ends, h->ends) && image.lend(s.table, h->table)
+            && (s.ends.size() == 0 || s.ends[s.ends.size() - 1] <= s.names.size())
+            && (s.table.size() & (s.table.size() - 1)) == 0 && (s.ends.size() == 0 || s.table.size() > s.ends.size())
+            && h->order.count == h->keys;
+    for (std::size_t id = 1; ok && id < s.ends.size(); id++) {
+        ok = s.ends[id - 1] <= s.ends[id];
+    }
+    s.columns.resize(ok ? h->keys : 0);
+    for (std::uint32_t key = 0; key < s.columns.size() && ok; key++) {
+        const cacheColumn& c = columns[key];
+        column& col = s.columns[key];
+        ok = image.at<char>(c.name) != nullptr && s.keys.intern(image.text(c.name)) == key
+                && image.lend(col.present.raw(), c.words) && image.lend(col.cells, c.cells) && image.lend(col.text, c.text)
+                && sound(col, s.size());
+    }
+    for (std::uint64_t at = 0; ok && at < h->order.count; at++) {
+        ok = order[at] < h->keys;
+        s.order.push_back(order[at]);
+    }
+    if (!ok) {
+        return false;
+    }
+    s.image = image.mapping;
+    profile.current.items += s.size();
+    db = std::move(s);
+    return true;
+}
+
+// borrows 'db' from the snapshot of the database at 'path' as it is now, without reading the database itself.
+// false if there is none, or the database is part of a transaction.
+bool mapped(const std::string path, store& db) {
+    if (batch.covers(path)) {
+        return false;
+    }
+    snapshot file(path);
+    std::string cache = cachePath(path);
+    return file.good() && cache != "" && restore(cache, path, inodeOf(file.fd), stampOf(file.fd), db);
+}
+
+// reads the database at 'path' into columns: from its snapshot if it has not changed since, and otherwise
+// one item at a time, leaving a snapshot for next time.
+store load(parameter& parent, const std::string path) {
+    store db;
+    auto add = [&](const json& j) {
+        timer t(phase::scan);
+        try {
+            db.append(j);
+        } catch (const json::exception&) { // no identifier
+            fatal(parent.prettify() + JSON_ERROR);
+        }
+        return true;
+    };
+    if (batch.covers(path)) {
+        stream(parent, path, add);
+        return db;
+    }
+
+    snapshot file(path);
+    indexStamp stamp = stampOf(file.fd);
+    std::uint64_t inode = inodeOf(file.fd);
+    std::string cache = cachePath(path);
+    if (file.good() && cache != "" && restore(cache, path, inode, stamp, db)) {
+        return db;
+    }
+    stream(parent, file, add);
+    if (file.good() && cache != "") {
+        timer t(phase::serialize);
+        save(cache, path, inode, stamp, db);
+    }
+    return db;
+}
+
+/*////////////////////////*
+//  PARAM VALUE GETTERS  //
+*////////////////////////*/
+
+// returns 'value', writing 'error' to the console if it is not present.
+const std::string require(parameter& parent, const std::string value, const std::string error, bool raises = true) {
+    if (value == "" && raises) {
+        fatal(parent.prettify() + error);
+    }
+    return value;
+}
+
+// gets outfile path
+const std::string getOut(parameter& parent, bool raises = false, const std::string default_to = DATABASE) {
+    std::string out = require(parent, config.outfile, OUTFILE_GET_ERROR, raises);
+    if (out == "") {
+        warning(parent.prettify() + ": No outfile provided, defaulting to '"+ default_to +"'.");
+        out = default_to;
+        if (!fs::exists(out)) {
+            fatal(parent.prettify() + OUTFILE_NO_EXIST_ERROR);
+        } else {
+            // set as outfile final
+            config.outfile = out;
+        }
+    }
+    return out;
+}
+
+// gets item identifier
+const std::string getItem(parameter& parent, bool raises = true) {
+    return require(parent, config.item, ITEM_GET_ERROR, raises);
+}
+
+// gets key for modification
+const std::vector<std::string> getKeys(parameter& parent, bool raises = true) {
+    if (config.keys.empty() && raises) {
+        fatal(parent.prettify() + NO_KEY_ERROR);
+    }
+    return config.keys;
+}
+
+// gets type for modification
+const std::vector<std::string> getTypes() {
+    return config.types;
+}
+
+// gets the number of worker threads, defaulting to the number of cores, and never above MAX_THREADS
+unsigned getThreads() {
+    if (config.threads == 0) {
+        unsigned cores = std::thread::hardware_concurrency();
+        return std::min(cores > 0 ? cores : 1, MAX_THREADS);
+    }
+    return std::min(config.threads, MAX_THREADS);
+}
+
+// shifts every byte of 'in' by 'shift' into 'out', spreading the bytes across 'workers'.
+// every byte is independent of the others, so any split gives the same result.
+void charshift(pool& workers, const char * in, char * out, std::size_t size, int shift) {
+    workers.run(size, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            out[i] = (char)(in[i] + shift);
+        }
+    });
+}
+
+// streams 'fin', of 'total' bytes, through charshift into 'emit' one block at a time, keeping the output in order.
+// no more workers are started, and no bigger a block is held, than the file needs.
+void charshift(parameter& parent, std::istream& fin, std::uint64_t total, int shift, std::function<void(const char *, std::size_t)> emit) {
+    unsigned threads = std::min<std::uint64_t>(getThreads(), total / SHIFT_CHUNK + 1);
+    pool workers(threads);
+    if (!workers.good()) {
+        fatal(parent.prettify() + THREAD_START_ERROR);
+    }
+    std::vector<char> block(std::max<std::uint64_t>(1, std::min<std::uint64_t>(total, (std::uint64_t)SHIFT_CHUNK * threads)));
+    while (fin) {
+        fin.read(block.data(), block.size());
+        std::size_t got = fin.gcount();
+        if (got == 0) {
+            break;
+        }
+        profile.current.read += got;
+        {
+            timer t(phase::crypt);
+            charshift(workers, block.data(), block.data(), got, shift);
+        }
+        emit(block.data(), got);
+    }
+}
+
+/*/////////////*
+//  PAGINATION  //
+*/////////////*/
+
+// hashes an identifier for a cursor, so a resumed page can tell if the database moved underneath it.
+std::uint32_t fingerprint(std::string_view identifier) {
+    return nametable::hash(identifier, 0);
+}
+
+// decides which matching items make it onto the page asked for by l/limit, m/offset and u/cursor.
+class page {
+    private:
+        std::size_t skip = config.offset; // matching items still to pass over
+        std::size_t left = config.limit; // items still to show
+        std::size_t from = 0; // item position the cursor resumes at
+        std::uint32_t expect = 0; // fingerprint of the item at 'from'
+        std::size_t position = 0; // of the item being visited
+        bool resumed = false;
+        bool resumable = true; // items are visited in file order, which a cursor can point into
+
+    public:
+        page(parameter& parent, bool resumable = true) : resumable(resumable) {
+            if (config.cursor == "") {
+                return;
+            }
+            if (!resumable) {
+                fatal(parent.prettify() + SORT_CURSOR_ERROR);
+                return;
+            }
+            resumed = true;
+            std::size_t dash = config.cursor.find('-');
+            try {
+                from = std::stoull(config.cursor.substr(0, dash));
+                expect = std::stoul(config.cursor.substr(dash + 1), nullptr, 16);
+            } catch (const std::exception&) {
+                fatal(parent.prettify() + INVALID_CURSOR_ERROR);
+            }
+            if (dash == std::string::npos) {
+                fatal(parent.prettify() + INVALID_CURSOR_ERROR);
+            }
+        }
+
+        // moves on to the next item in the database. returns false if it comes before the cursor.
+        bool next(parameter& parent, std::string_view identifier) {
+            std::size_t at = position++;
+            if (at < from) {
+                return false;
+            }
+            if (resumed && at == from) {
+                resumed = false;
+                if (fingerprint(identifier) != expect) {
+                    warning(parent.prettify() + CURSOR_MOVED_ERROR);
+                }
+            }
+            return true;
+        }
+
+        enum verdict { skipped, shown, full };
+
+        // called for every item that matches. once the page is full, the next match
+        // prints the cursor that resumes from it.
+        verdict take(std::string_view identifier) {
+            if (skip > 0) {
+                skip--;
+                return skipped;
+            }
+            if (left == 0 && !resumable) {
+                paint<style::grey, style::italic>(console, "More items follow. Continue with '-m "
+                        + std::to_string(config.offset + config.limit) + "'.") << '\n';
+                return full;
+            } else if (left == 0) {
+                std::ostringstream cursor;
+                cursor << (position - 1) << "-" << std::hex << fingerprint(identifier);
+                paint<style::grey, style::italic>(console, "More items follow. Continue with '-u " + cursor.str() + "'.") << '\n';
+                return full;
+            }
+            left--;
+            return shown;
+        }
+};
+
+/*//////////////*
+//  SELECTION  //
+*//////////////*/
+
+// whether 'text' matches the glob 'pattern', in which '*' stands for any run of characters and '?' for any one.
+bool globs(std::string_view pattern, std::string_view text) {
+    std::size_t p = 0, t = 0;
+    std::size_t star = std::string_view::npos, resume = 0; // the last '*', and where in 'text' it was tried from
+    while (t < text.size()) {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == text[t])) {
+            p++;
+            t++;
+        } else if (p < pattern.size() && pattern[p] == '*') {
+            star = p++;
+            resume = t;
+        } else if (star != std::string_view::npos) {
+            // let the last '*' swallow one more character
+            p = star + 1;
+            t = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*') {
+        p++;
+    }
+    return p == pattern.size();
+}
+
+// a condition on items' values, such as 'status=="stale" && age>30', compiled once into a postfix
+// program of comparisons that is then run against each item in turn. a key alone tests that an item has it.
+class predicate {
+    public:
+        enum op { eq, ne, lt, le, gt, ge, has };
+
+    private:
+        struct comparison {
+            std::string key;
+            op o;
+            json literal;
+            bool identifier = false; // compares the item's identifier
+            std::uint32_t symbol = symbols::none; // the key's column, once bound to a store
+        };
+
+        enum code { test, both, either, negate };
+
+        struct step {
+            code c;
+            std::uint32_t at; // the comparison, for a test
+        };
+
+        std::vector<comparison> comparisons;
+        std::vector<step> program;
+        bool valid = false;
+
+        // while compiling
+        parameter * parent = nullptr;
+        std::string_view source;
+        std::size_t at = 0;
+        int depth = 0; // of the stack, as the program stands
+
+        void fail() {
+            if (valid) {
+                fatal(parent->prettify() + PREDICATE_ERROR);
+            }
+            valid = false;
+        }
+
+        void emit(code c, std::uint32_t at = 0) {
+            program.push_back({c, at});
+            depth += c == test ? 1 : c == negate ? 0 : -1;
+            // the stack is the bits of one word
+            if (depth > 64) {
+                fail();
+            }
+        }
+
+        void space() {
+            while (at < source.size() && std::isspace((unsigned char)source[at])) {
+                at++;
+            }
+        }
+
+        bool take(std::string_view token) {
+            space();
+            if (source.substr(at, token.size()) == token) {
+                at += token.size();
+                return true;
+            }
+            return false;
+        }
+
+        // a quoted string, quotes and all, or a run of anything that cannot end one.
+        std::string_view word() {
+            space();
+            std::size_t begin = at;
+            if (at < source.size() && source[at] == '"') {
+                for (at++; at < source.size() && source[at] != '"'; at++) {
+                    at += source[at] == '\\';
+                }
+                at = std::min(at + 1, source.size());
+            } else {
+                while (at < source.size() && !std::isspace((unsigned char)source[at])
+                        && std::string_view("()!=<>&|\"").find(source[at]) == std::string_view::npos) {
+                    at++;
+                }
+            }
+            return source.substr(begin, at - begin);
+        }
+
+        // a literal: anything JSON would take, and otherwise a bare string.
+        json literal(std::string_view w) {
+            try {
+                return json::parse(w);
+            } catch (const json::exception&) {
+                if (w.empty() || w[0] == '"') {
+                    fail();
+                }
+                return std::string(w);
+            }
+        }
+
+        void compare() {
+            comparison c;
+            std::string_view key = word();
+            json k = literal(key);
+            if (key.empty() || (key[0] == '"' && !k.is_string())) {
+                return fail();
+            }
+            c.key = k.is_string() ? k.get<std::string>() : std::string(key);
+            c.identifier = c.key == "identifier";
+            if (take("==")) {
+                c.o = eq;
+            } else if (take("!=")) {
+                c.o = ne;
+            } else if (take("<=")) {
+                c.o = le;
+            } else if (take(">=")) {
+                c.o = ge;
+            } else if (take("<")) {
+                c.o = lt;
+            } else if (take(">")) {
+                c.o = gt;
+            } else if (take("=")) {
+                c.o = eq;
+            } else {
+                c.o = has;
+            }
+            if (c.o != has) {
+                std::string_view w = word();
+                c.literal = literal(w);
+                if (w.empty()) {
+                    return fail();
+                }
+            }
+            comparisons.push_back(std::move(c));
+            emit(test, comparisons.size() - 1);
+        }
+
+        void unary() {
+            if (take("!")) {
+                unary();
+                emit(negate);
+            } else if (take("(")) {
+                expression();
+                if (!take(")")) {
+                    fail();
+                }
+            } else {
+                compare();
+            }
+        }
+
+        void conjunction() {
+            unary();
+            while (valid && take("&&")) {
+                unary();
+                emit(both);
+            }
+        }
+
+        void expression() {
+            conjunction();
+            while (valid && take("||")) {
+                conjunction();
+                emit(either);
+            }
+        }
+
+        static bool ordered(int order, op o) {
+            switch (o) {
+                case eq: return order == 0;
+                case ne: return order != 0;
+                case lt: return order < 0;
+                case le: return order <= 0;
+                case gt: return order > 0;
+                case ge: return order >= 0;
+                default: return true;
+            }
+        }
+
+        // whether 'value' stands in the comparison's relation to its literal. values of different
+        // types are only ever unequal, except that any number compares with any other.
+        static bool holds(const json& value, const comparison& c) {
+            if (c.o == has) {
+                return true;
+            }
+            if (value.is_string() && c.literal.is_string()) {
+                return ordered(value.get_ref<const std::string&>().compare(c.literal.get_ref<const std::string&>()), c.o);
+            }
+            if (!(value.is_number() && c.literal.is_number()) && value.type() != c.literal.type()) {
+                return c.o == ne;
+            }
+            return ordered(value == c.literal ? 0 : value < c.literal ? -1 : 1, c.o);
+        }
+
+        static bool holds(std::string_view value, const comparison& c) {
+            if (c.o == has) {
+                return true;
+            }
+            if (!c.literal.is_string()) {
+                return c.o == ne;
+            }
+            return ordered(value.compare(c.literal.get_ref<const std::string&>()), c.o);
+        }
+
+        // runs the program, with 'check' telling whether an item passes each comparison.
+        template<typename Check>
+        bool run(Check check) const {
+            if (!valid) {
+                return false;
+            }
+            std::uint64_t stack = 0;
+            for (const step& s : program) {
+                switch (s.c) {
+                    case test:
+                        stack = stack << 1 | check(comparisons[s.at]);
+                        break;
+                    case both:
+                        stack = (stack >> 1) & (stack | ~1ull);
+                        break;
+                    case either:
+                        stack = (stack >> 1) | (stack & 1);
+                        break;
+                    case negate:
+                        stack ^= 1;
+                        break;
+                }
+            }
+            return stack & 1;
+        }
+
+    public:
+        predicate() = default;
+
+        predicate(parameter& parent, std::string_view source) : valid(true), parent(&parent), source(source) {
+            expression();
+            space();
+            if (at != source.size()) {
+                fail();
+            }
+            this->source = {};
+        }
+
+        // looks each key up among the store's columns, once, for the calls that take a store.
+        void bind(const store& db) {
+            for (auto& c : comparisons) {
+                c.symbol = db.keys.find(c.key);
+            }
+        }
+
+        bool operator()(const json& item) const {
+            return run([&](const comparison& c) {
+                auto it = item.find(c.key);
+                return it != item.end() ? holds(*it, c) : c.o == ne;
+            });
+        }
+
+        bool operator()(const store& db, std::size_t id) const {
+            return run([&](const comparison& c) {
+                if (c.identifier) {
+                    return holds(db.identifier(id), c);
+                }
+                if (c.symbol == symbols::none || !db.columns[c.symbol].present.test(id)) {
+                    return c.o == ne;
+                }
+                const column& col = db.columns[c.symbol];
+                if (col.cells[id].type == json::value_t::string) {
+                    return holds(col.view(id), c);
+                }
+                return holds(col.get(id), c);
+            });
+        }
+};
+
+// the items a command acts on, as given to @/item: one identifier, '[ALL]', several separated by commas,
+// '@' followed by a file with one on each line, a glob such as 'user-*', or 'where' followed by a
+// predicate on their values. nothing given means all.
+class selection {
+    public:
+        enum kind { one, all, listed, pattern, filtered };
+
+    private:
+        kind k = all;
+        std::string text; // the identifier or the pattern
+        std::unordered_set<std::string> ids;
+        predicate where;
+
+    public:
+        selection(parameter& parent, const std::string raw) {
+            std::vector<std::string> given;
+            if (raw == "" || raw == "[ALL]") {
+                return;
+            } else if (raw.compare(0, 6, "where ") == 0) {
+                k = filtered;
+                where = predicate(parent, std::string_view(raw).substr(6));
+                return;
+            } else if (raw[0] == '@') {
+                std::ifstream file(raw.substr(1));
+                if (!file) {
+                    fatal(parent.prettify() + ITEM_FILE_ERROR);
+                    return;
+                }
+                std::string line;
+                while (std::getline(file, line)) {
+                    if (!line.empty() && line.back() == '\r') {
+                        line.pop_back();
+                    }
+                    given.push_back(line);
+                }
+            } else if (raw.find(',') != std::string::npos) {
+                given = split(raw);
+            } else if (raw.find_first_of("*?") != std::string::npos) {
+                k = pattern;
+                text = raw;
+                return;
+            } else {
+                k = one;
+                text = raw;
+                return;
+            }
+
+            for (auto& id : given) {
+                if (!id.empty()) {
+                    ids.insert(std::move(id));
+                }
+            }
+            if (ids.size() == 1) {
+                k = one;
+                text = *ids.begin();
+            } else {
+                k = listed;
+            }
+        }
+
+        kind what() const {
+            return k;
+        }
+
+        // the identifier, when exactly one item is selected.
+        const std::string& identifier() const {
+            return text;
+        }
+
+        // every identifier listed, when several are.
+        const std::unordered_set<std::string>& identifiers() const {
+            return ids;
+        }
+
+        // whether the item called 'identifier' is selected. a predicate needs the whole item.
+        bool matches(std::string_view identifier) const {
+            switch (k) {
+                case one:
+                    return identifier == text;
+                case listed:
+                    return ids.count(std::string(identifier)) > 0;
+                case pattern:
+                    return globs(text, identifier);
+                case filtered:
+                    return false;
+                default:
+                    return true;
+            }
+        }
+
+        bool matches(const std::string& identifier) const {
+            return matches(std::string_view(identifier));
+        }
+
+        bool matches(const json& item) const {
+            if (k == filtered) {
+                return where(item);
+            }
+            auto id = item.find("identifier");
+            return k == all || (id != item.end() && id->is_string() && matches(id->get_ref<const std::string&>()));
+        }
+
+        // for matching items held in 'db'.
+        void bind(const store& db) {
+            where.bind(db);
+        }
+
+        bool matches(const store& db, std::size_t id) const {
+            return k == filtered ? where(db, id) : matches(db.identifier(id));
+        }
+};
+
+/*////////////*
+//  SORTING  //
+*////////////*/
+
+// the order O/sort asks for: by each item's value for one key, compared as the first t/type if one was given,
+// or by JSON type (null, boolean, number, string, then the rest) and then value if not.
+// items without the key come last whichever way, and ties keep file order.
+class ordering {
+    public:
+        // where an item's value falls.
+        struct rank {
+            int kind = -1; // -1 for no value, then by JSON type as above
+            double number = 0;
+            std::string text;
+        };
+
+    private:
+        enum compared { natural, numeric, textual };
+
+        std::string key;
+        bool descending = false;
+        compared as = natural;
+        std::uint32_t symbol = symbols::none; // the key's column, once bound to a store
+
+        // 'text' is a string's contents, or the JSON of anything else.
+        rank make(json::value_t type, double number, std::string_view text) const {
+            rank r;
+            bool isString = type == json::value_t::string;
+            if (as == numeric) {
+                if (isString) {
+                    std::string raw(text);
+                    char * end = nullptr;
+                    number = std::strtod(raw.c_str(), &end);
+                    if (raw.empty() || *end != '\0') {
+                        return r;
+                    }
+                } else if (type == json::value_t::null || type == json::value_t::array || type == json::value_t::object) {
+                    return r;
+                }
+                r.kind = 2;
+                r.number = number;
+            } else if (as == textual) {
+                r.kind = 3;
+                r.text = text;
+            } else {
+                switch (type) {
+                    case json::value_t::null: r.kind = 0; break;
+                    case json::value_t::boolean: r.kind = 1; break;
+                    case json::value_t::number_integer:
+                    case json::value_t::number_unsigned:
+                    case json::value_t::number_float: r.kind = 2; break;
+                    case json::value_t::string: r.kind = 3; break;
+                    default: r.kind = 4; break;
+                }
+                r.number = number;
+                if (r.kind >= 3) {
+                    r.text = text;
+                }
+            }
+            return r;
+        }
+
+    public:
+        ordering() = default;
+
+        ordering(parameter& parent, const std::string raw, const std::vector<std::string>& types) : key(raw) {
+            if (raw == "") {
+                return;
+            }
+            std::size_t colon = raw.rfind(':');
+            if (colon != std::string::npos && (raw.substr(colon + 1) == "desc" || raw.substr(colon + 1) == "asc")) {
+                descending = raw.substr(colon + 1) == "desc";
+                key = raw.substr(0, colon);
+            }
+            if (key.empty()) {
+                fatal(parent.prettify() + INVALID_SORT_ERROR);
+            }
+            if (!types.empty()) {
+                const std::string& t = types.front();
+                if (t == "int" || t == "integer" || t == "float" || t == "decimal") {
+                    as = numeric;
+                } else if (t == "string") {
+                    as = textual;
+                }
+            }
+        }
 
-std::vector<parameter> mainParameters;
+        // whether any order was asked for, rather than file order.
+        explicit operator bool() const {
+            return !key.empty();
+        }
 
-/*///////////////////////////////*
-//  PARAMETER VALUE MODIF/READ  //
-*///////////////////////////////*/
+        // looks the key up among the store's columns, once, for the calls that take a store.
+        void bind(const store& db) {
+            symbol = db.keys.find(key);
+        }
 
-void setParameterValue(std::initializer_list<const char *> names, const std::string value) {
-    std::vector<const char *> ns = names;
-    for (auto& p : mainParameters) {
-        if (ns[0] == p.names[0]) {
-            p.result = value;
-            return;
+        rank of(const json& item) const {
+            auto it = item.find(key);
+            if (it == item.end()) {
+                return {};
+            }
+            const json& v = *it;
+            double number = v.is_number() ? v.get<double>() : v.is_boolean() ? v.get<bool>() : 0;
+            if (v.is_string()) {
+                return make(v.type(), number, v.get_ref<const std::string&>());
+            }
+            return make(v.type(), number, v.is_structured() || as == textual ? v.dump() : "");
         }
-    }
-}
 
-void setParameterValue(const char * name, const std::string value) {
-    return setParameterValue({name}, value);
-}
+        rank of(const store& db, std::size_t id) const {
+            if (key == "identifier") {
+                return make(json::value_t::string, 0, db.identifier(id));
+            }
+            if (symbol == symbols::none || !db.columns[symbol].present.test(id)) {
+                return {};
+            }
+            const column& col = db.columns[symbol];
+            const column::cell& c = col.cells[id];
+            double number = 0;
+            switch (c.type) {
+                case json::value_t::boolean: number = c.number.boolean; break;
+                case json::value_t::number_integer: number = c.number.integer; break;
+                case json::value_t::number_unsigned: number = c.number.unsign; break;
+                case json::value_t::number_float: number = c.number.decimal; break;
+                default: break;
+            }
+            return make(c.type, number, col.view(id));
+        }
 
-parameter* getParameter(const char * name) {
-    for (auto& p : mainParameters) {
-        for (auto& n : p.names) {
-            if (n == name) {
-                return &p;
+        // whether the item at 'pa' ranked 'a' goes before the one at 'pb' ranked 'b'.
+        bool before(const rank& a, std::size_t pa, const rank& b, std::size_t pb) const {
+            if ((a.kind < 0) != (b.kind < 0)) {
+                return b.kind < 0;
             }
+            int order = 0;
+            if (a.kind != b.kind) {
+                order = a.kind < b.kind ? -1 : 1;
+            } else if (a.kind == 1 || a.kind == 2) {
+                order = a.number < b.number ? -1 : a.number > b.number ? 1 : 0;
+            } else {
+                order = a.text.compare(b.text);
+            }
+            if (order != 0) {
+                return descending ? order > 0 : order < 0;
+            }
+            return pa < pb;
         }
-    }
-    return nullptr; 
-}
+};
 
-/*//////////////*
-//  COLOURING  //
-*//////////////*/
+// the first items in an ordering, of those offered to it. only 'keep' are ever held, in a heap with
+// the last of them on top, so that finding the top few of many takes as little memory as showing them.
+class ranking {
+    private:
+        struct ranked {
+            ordering::rank r;
+            std::size_t position;
+        };
 
-// a proxy for the paint function, used for c/colourless parameter.
-template<typename T>
-const std::string paint(T value, std::vector<const char *> cns) {
-    parameter* call = getParameter("c");
-    if (call->result == "colourless") {
-        std::ostringstream oss;
-        oss << value;
-        return oss.str();
-    } else {
-        return pty::paint(value, cns);
-    }
-}
+        const ordering& by;
+        std::size_t keep;
+        std::vector<ranked> heap;
 
-template<typename T>
-const std::string paint(T value, std::initializer_list<const char *> cns) {
-    return paint(value, std::vector(cns));
-}
+        bool less(const ranked& a, const ranked& b) const {
+            return by.before(a.r, a.position, b.r, b.position);
+        }
 
-template<typename T>
-const std::string paint(T value, const char * cn) {
-    return paint(value, {cn});
-}
-
-// highlights 'term' in 'value' and returns the result. paints non-highlighted with 'others'.
-const std::string highlight(const std::string value, const std::string term, std::initializer_list<const char *> others) {
-    // dont bother if the value is not present
-    std::string first;
-    std::string ter;
-    std::string after;
-    if (value.find(term) == std::string::npos) {
-        return paint(value, others);
-    } else {
-        int place = value.find(term);
-        for (int i = 0; i < value.size(); i++) {
-            // first
-            if (i < place) {
-                first += value[i];
+    public:
+        ranking(const ordering& by, std::size_t keep) : by(by), keep(keep) {}
+
+        // offers the item at 'position', ranked 'r', which is kept while it is among the first 'keep'.
+        void offer(std::size_t position, ordering::rank r) {
+            if (keep == 0) {
+                return;
             }
-            // term
-            else if (i >= place && i < term.size()) {
-                ter += value[i];
+            auto cmp = [this](const ranked& a, const ranked& b) { return less(a, b); };
+            if (heap.size() == keep) {
+                if (!less({r, position}, heap.front())) {
+                    return;
+                }
+                std::pop_heap(heap.begin(), heap.end(), cmp);
+                heap.back() = {std::move(r), position};
+            } else {
+                heap.push_back({std::move(r), position});
             }
-            // after
-            else {
-                after += value[i];
+            std::push_heap(heap.begin(), heap.end(), cmp);
+        }
+
+        // the positions of what was kept, first first.
+        std::vector<std::size_t> positions() {
+            std::sort_heap(heap.begin(), heap.end(), [this](const ranked& a, const ranked& b) { return less(a, b); });
+            std::vector<std::size_t> out;
+            for (const auto& r : heap) {
+                out.push_back(r.position);
             }
+            return out;
         }
-        // paint
-        first = paint(first, others);
-        after = highlight(after, term, others);
-    }
+};
 
-    // form and return
-    std::vector<const char *> os = others;
-    os.push_back("reversefield"); 
-    return first + paint(ter, os) + after;
+// how many sorted items need keeping: no more than N/top, nor than the page asked for goes up to,
+// plus one to tell whether more follow it.
+std::size_t keeping() {
+    std::size_t upto = config.limit == SIZE_MAX || config.offset > SIZE_MAX - config.limit - 1 ? SIZE_MAX : config.offset + config.limit + 1;
+    return std::min(config.top, upto);
 }
 
-/*////////////*
-//  LOGGING  //
-*////////////*/
+/*////////////////*
+//  AGGREGATION  //
+*////////////////*/
 
-// returns a fatal error and exits.
-template<typename T>
-int fatal(T sad, int status = 1) {
-    std::cout << paint(sad, "lightred") << " [" << paint(status, {"red", "dim"}) << "]" << std::endl;
-    if (getParameter("F")->passed != "force") {
-        exit(status);
-    }
-    return status;
-}
+// what A/agg is asked to work out, such as 'count, sum(price), avg(price) by category', and
+// the running totals it keeps for each group of items as they stream past.
+class aggregation {
+    public:
+        enum function { count, sum, avg, min, max };
 
-// middlepoint of fatal and success.
-template<typename T>
-float warning(T headscratch, float status = 0.5) {
-    if (getParameter("V")->passed == "verbose") {
-        std::cout << paint(headscratch, "yellow") << " [" << paint(status, {"yellow", "dim"}) << "]" << std::endl;
-    }
-    return status;
-}
+        struct aggregate {
+            function f;
+            std::string key; // empty for a plain count of items
+            std::string name; // as it was asked for
+        };
 
-// the opposite of fatal.
-template<typename T>
-int success(T hooray, int status = 0) {
-    std::cout << paint(hooray, "lightgreen") << " [" << paint(status, "green") << "]" << std::endl;
-    return status;
-}
+        // one aggregate's running total within one group. only numbers are summed, averaged and compared.
+        struct tally {
+            std::uint64_t count = 0;
+            std::uint64_t numbers = 0; // of those counted
+            double sum = 0;
+            bool integral = true; // every value summed so far was a whole number
+            json min, max;
 
-/*///////////////*
-//  READ/WRITE  //
-*///////////////*/
+            void add(const json& value, function f) {
+                count++;
+                if (f == aggregation::count || !value.is_number()) {
+                    return;
+                }
+                numbers++;
+                sum += value.get<double>();
+                integral = integral && value.is_number_integer();
+                if (min.is_null() || value < min) {
+                    min = value;
+                }
+                if (max.is_null() || max < value) {
+                    max = value;
+                }
+            }
 
-// used for reading json in conjunction with parameters.
-nm::json read(parameter& parent, const std::string path) {
-    // read json data
-    std::ifstream file(path);
-    nm::json jf;
-    try {
-        jf = nm::json::parse(file);
-    } catch (nm::json::exception) { // catch json errors
-        return fatal(parent.prettify() + JSON_ERROR);
-    }
-    file.close(); // safe and snuggly!
-    
-    // make sure is array
-    if (!jf.is_array()) {
-        return fatal(parent.prettify() + JSON_ERROR);
-    }
+            void merge(const tally& other) {
+                count += other.count;
+                numbers += other.numbers;
+                sum += other.sum;
+                integral = integral && other.integral;
+                if (!other.min.is_null() && (min.is_null() || other.min < min)) {
+                    min = other.min;
+                }
+                if (!other.max.is_null() && (max.is_null() || max < other.max)) {
+                    max = other.max;
+                }
+            }
+        };
 
-    return jf;
-}
+        // every group, by the JSON of its value for the grouping key (empty for items without it).
+        using groups = std::unordered_map<std::string, std::vector<tally>>;
 
-// used for writing json in conjunction with parameters.
-void write(parameter& parent, const std::string path, nm::json& value) {
-    // write to file
-    std::ofstream out(path);
-    out << std::setw(4) << value << std::endl;
-    out.close();
-}
+        std::vector<aggregate> aggregates;
+        std::string by; // the grouping key, if any
 
-/*////////////////////////*
-//  PARAM VALUE GETTERS  //
-*////////////////////////*/
+        aggregation(parameter& parent, const std::string raw) {
+            std::string list = raw;
+            std::size_t split = raw.rfind(" by ");
+            if (split != std::string::npos) {
+                list = raw.substr(0, split);
+                by = trim(raw.substr(split + 4));
+                if (by.empty()) {
+                    fatal(parent.prettify() + INVALID_AGGREGATE_ERROR);
+                }
+            }
+            static const std::pair<const char *, function> names[] = {{"count", count}, {"sum", sum}, {"avg", avg}, {"min", min}, {"max", max}};
+            for (const auto& piece : ::split(list)) {
+                std::string term = trim(piece);
+                std::size_t open = term.find('(');
+                aggregate a;
+                a.name = term;
+                std::string f = trim(term.substr(0, open));
+                if (open != std::string::npos) {
+                    if (term.back() != ')') {
+                        fatal(parent.prettify() + INVALID_AGGREGATE_ERROR);
+                        continue;
+                    }
+                    a.key = trim(term.substr(open + 1, term.size() - open - 2));
+                }
+                bool known = false;
+                for (const auto& n : names) {
+                    if (f == n.first) {
+                        a.f = n.second;
+                        known = true;
+                    }
+                }
+                // only count goes without a key
+                if (!known || (a.key.empty() && a.f != count)) {
+                    fatal(parent.prettify() + INVALID_AGGREGATE_ERROR);
+                    continue;
+                }
+                aggregates.push_back(std::move(a));
+            }
+            if (aggregates.empty()) {
+                fatal(parent.prettify() + INVALID_AGGREGATE_ERROR);
+            }
+        }
 
-// iterates all parameters until the one with a name of 'firstName' is found, then returns that parameters final value.
-// writes 'error' string to the console if the final value is not present.
-const std::string getFinal(parameter& parent, const std::string firstName, const std::string error, bool raises = true) {
-    std::string result;
-    for (const auto& p : mainParameters) {
-        if (p.names[0] == firstName) {
-            if (p.result == "") {
-                if (raises) {
-                    fatal(parent.prettify() + error);
-                } else {
+        // whether items have to be looked inside at all, rather than only counted.
+        bool looks() const {
+            if (!by.empty()) {
+                return true;
+            }
+            for (const auto& a : aggregates) {
+                if (!a.key.empty()) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // adds 'item' to the totals of its group in 'into'.
+        void add(groups& into, const json& item) const {
+            std::string group;
+            if (!by.empty()) {
+                auto it = item.find(by);
+                if (it != item.end()) {
+                    group = it->dump();
+                }
+            }
+            std::vector<tally>& tallies = into[group];
+            tallies.resize(aggregates.size());
+            for (std::size_t i = 0; i < aggregates.size(); i++) {
+                const aggregate& a = aggregates[i];
+                if (a.key.empty()) {
+                    tallies[i].count++;
                     continue;
                 }
-            } else {
-                result = p.result;
-                break;
+                auto it = item.find(a.key);
+                if (it != item.end()) {
+                    tallies[i].add(*it, a.f);
+                }
             }
         }
-    }
-    return result;
-}
 
-// gets outfile path
-const std::string getOut(parameter& parent, bool raises = false, const std::string default_to = DATABASE) {
-    std::string out = getFinal(parent, "o", OUTFILE_GET_ERROR, raises);
-    if (out == "") {
-        warning(parent.prettify() + ": No outfile provided, defaulting to '"+ default_to +"'.");
-        out = default_to;
-        if (!fs::exists(out)) {
-            fatal(parent.prettify() + OUTFILE_NO_EXIST_ERROR);
-        } else {
-            // set as outfile final
-            for (auto& p : mainParameters) {
-                if (p.names[0] == "o") {
-                    p.result = out;
+        // folds the totals of 'from' into 'into'.
+        void merge(groups& into, groups& from) const {
+            for (auto& g : from) {
+                std::vector<tally>& tallies = into[g.first];
+                if (tallies.empty()) {
+                    tallies = std::move(g.second);
+                    continue;
+                }
+                for (std::size_t i = 0; i < aggregates.size(); i++) {
+                    tallies[i].merge(g.second[i]);
                 }
             }
         }
-    }
-    return out;
-}
 
-// gets item identifier
-const std::string getItem(parameter& parent, bool raises = true) {
-    return getFinal(parent, "@", ITEM_GET_ERROR, raises);
-}
+        // what one aggregate came to, from its totals.
+        json result(const aggregate& a, const tally& t) const {
+            switch (a.f) {
+                case count:
+                    return t.count;
+                case sum:
+                    if (t.integral && std::abs(t.sum) < 9007199254740992.0) {
+                        return (std::int64_t)t.sum;
+                    }
+                    return t.sum;
+                case avg:
+                    return t.numbers == 0 ? json() : json(t.sum / t.numbers);
+                case min:
+                    return t.min;
+                default:
+                    return t.max;
+            }
+        }
+};
 
-// gets key for modification
-const std::vector<std::string> getKeys(parameter& parent, bool raises = true) {
-    std::stringstream raw = std::stringstream(getFinal(parent, "k", NO_KEY_ERROR, raises));
-    std::vector<std::string> keys;
-    std::string segment;
-    while(std::getline(raw, segment, ',')) {
-        keys.push_back(segment);
-    }
-    return keys;
-}
+/*///////////////*
+//  STATISTICS  //
+*///////////////*/
 
-// gets vals for modification
-const std::vector<std::string> getVals(const std::string _raw) {
-    std::stringstream raw = std::stringstream(_raw);
-    std::vector<std::string> vals;
-    std::string segment;
-    while(std::getline(raw, segment, ',')) {
-        vals.push_back(segment);
+// estimates how many distinct values have been added (HyperLogLog), in 2^HLL_BITS bytes
+// and to within a few percent, however many values there are.
+class hyperloglog {
+    private:
+        static constexpr std::size_t size = 1 << HLL_BITS;
+        std::array<std::uint8_t, size> registers {};
+
+    public:
+        void add(std::uint64_t hash) {
+            std::size_t index = hash >> (64 - HLL_BITS);
+            std::uint64_t rest = hash << HLL_BITS;
+            std::uint8_t rank = rest == 0 ? 64 - HLL_BITS + 1 : __builtin_clzll(rest) + 1;
+            registers[index] = std::max(registers[index], rank);
+        }
+
+        double estimate() const {
+            double sum = 0;
+            std::size_t zeros = 0;
+            for (auto r : registers) {
+                sum += std::ldexp(1.0, -r);
+                zeros += r == 0;
+            }
+            double m = size;
+            double e = (0.7213 / (1 + 1.079 / m)) * m * m / sum;
+            // small counts are better estimated by how many registers are untouched
+            if (e <= 2.5 * m && zeros > 0) {
+                e = m * std::log(m / zeros);
+            }
+            return e;
+        }
+};
+
+// everything S/stats gathers about one key across all items.
+struct keyStats {
+    std::uintmax_t present = 0;
+    std::map<std::string, std::uintmax_t> types;
+    std::array<std::uintmax_t, 33> lengths {}; // [0] is empty, [b] holds lengths in [2^(b-1), 2^b)
+    hyperloglog distinct;
+
+    // counts one value, measured and hashed by its text.
+    void add(const char * type, std::string_view text) {
+        present++;
+        types[type]++;
+        lengths[text.empty() ? 0 : 64 - __builtin_clzll(text.size())]++;
+        distinct.add(hash64(text));
     }
-    return vals;
-}
+};
 
-// gets type for modification
-const std::vector<std::string> getTypes(parameter& parent) {
-    std::stringstream raw = std::stringstream(getFinal(parent, "t", "", false));
-    std::vector<std::string> types;
-    std::string segment;
-    while(std::getline(raw, segment, ',')) {
-        types.push_back(segment);
+// the name S/stats and t/type use for a value's type.
+const char * typeName(json::value_t type) {
+    switch (type) {
+        case json::value_t::null: return "null";
+        case json::value_t::boolean: return "boolean";
+        case json::value_t::number_integer:
+        case json::value_t::number_unsigned: return "integer";
+        case json::value_t::number_float: return "decimal";
+        case json::value_t::string: return "string";
+        case json::value_t::array: return "array";
+        case json::value_t::object: return "object";
+        default: return "other";
     }
-    return types;
 }
 
 /*//////////////////////
@@ -317,13 +3238,14 @@ const std::vector<std::string> getTypes(parameter& parent) {
 *///////////////////////
 
 void help(parameter& parent, const std::string param) {
+    timer t(phase::render);
     std::string toc = "";
-    std::string order = paint("kial ", "magenta");
+    std::string order = paint<style::magenta>("kial ");
 
     for (auto& p : mainParameters) {
         // add to ordered text at end
         const char * eas = (p.blockingFunc ? "{}" : "[]");
-        order += paint(eas[0], "grey") + paint(p.prettify(), "yellow") + paint(eas[1], "grey") + " ";
+        order += paint<style::grey>(eas[0]) + paint<style::yellow>(p.prettify()) + paint<style::grey>(eas[1]) + " ";
         // if param is provided
         bool in;
         for (const auto& n : p.names) {
@@ -337,14 +3259,14 @@ void help(parameter& parent, const std::string param) {
         // add to toc
         if (param == ABSENT || in) {
             // name
-            toc += "⮑ " + paint("-" + p.prettify(), "magenta") + " ";
+            toc += "⮑ " + paint<style::magenta>("-" + p.prettify()) + " ";
             // takes
             if (p.passed != "") {
-                toc += paint(p.passedRequired ? "<" : "[", "grey") + paint(p.passed, "yellow") +
-                        paint(p.passedRequired ? ">" : "]", "grey");
+                toc += paint<style::grey>(p.passedRequired ? "<" : "[") + paint<style::yellow>(p.passed) +
+                        paint<style::grey>(p.passedRequired ? ">" : "]");
             }
             // desc
-            toc += "\n  " + paint(p.description, {"grey", "italic"}) + "\n";
+            toc += "\n  " + paint<style::grey, style::italic>(p.description) + "\n";
         }
     }
 
@@ -355,14 +3277,14 @@ void help(parameter& parent, const std::string param) {
 
     if (param == ABSENT) {
         // add github for extra help
-        toc = paint("Need extra help?\n", "turqoise") + paint((std::string)GITHUB + "\n\n", {"turqoise", "underlined"}) + toc;
-        toc += paint("\nParsing order:", {"bold"}) + "\n" + order;
+        toc = paint<style::turqoise>("Need extra help?\n") + paint<style::turqoise, style::underlined>((std::string)GITHUB + "\n\n") + toc;
+        toc += paint<style::bold>("\nParsing order:") + "\n" + order;
     } else {
         toc = "\n" + toc;
     }
 
     // feed to console :D
-    std::cout << toc << std::endl;
+    console << toc << '\n';
 }
 
 void outfile(parameter& parent, const std::string path) {
@@ -371,15 +3293,24 @@ void outfile(parameter& parent, const std::string path) {
         fatal(parent.prettify() + OUTFILE_NO_EXIST_ERROR);
     }
 
-    parent.result = path;
+    config.outfile = path;
 }
         
 void add(parameter& parent, const std::string identifier) {
+    // anything selection would read as several items could never be selected again
+    if (identifier == "[ALL]" || identifier.find_first_of(",*?") != std::string::npos || identifier[0] == '@'
+            || identifier.compare(0, 6, "where ") == 0) {
+        fatal(parent.prettify() + IDENTIFIER_ERROR);
+        return;
+    }
+
     // get path
     std::string path = getOut(parent);
+    lock guard(path); // held from reading through to writing
 
     // read json data
-    nm::json jf = read(parent, path);
+    json jf = read(parent, path);
+    timer t(phase::scan);
 
     // check if item with matching identifier is already in the database
     for (const auto& j : jf) {
@@ -389,7 +3320,7 @@ void add(parameter& parent, const std::string identifier) {
     }
 
     // form json object
-    nm::json it;
+    json it;
     it["identifier"] = identifier;
 
     jf.push_back(it); // add item
@@ -398,11 +3329,7 @@ void add(parameter& parent, const std::string identifier) {
     write(parent, path, jf);
 
     // ALSO set item to working item
-    for (auto& p : mainParameters) {
-        if (p.names[0] == "@") {
-            p.result = identifier;
-        }
-    }
+    config.item = identifier;
 
     // success message
     success("Item of identifier '" + identifier + "' has been added to the database.");
@@ -411,20 +3338,22 @@ void add(parameter& parent, const std::string identifier) {
 void erase(parameter& parent, const std::string _) {
     // get outpath and item
     std::string path = getOut(parent);
-    std::string identifier = getItem(parent);
+    lock guard(path); // held from reading through to writing
+    selection chosen(parent, getItem(parent));
 
     // read json
-    nm::json jf = read(parent, path);
+    json jf = read(parent, path);
+    timer t(phase::scan);
 
     // if no items to remove
     if (jf.empty()) {
         fatal(parent.prettify() + NO_ITEMS_TO_REMOVE_ERROR);
     }
 
-    auto n = nlohmann::json::array({});
+    auto n = json::array({});
     // iterate until found
     for (int i = 0; i < jf.size(); i++) {
-        if (jf[i]["identifier"] == identifier || identifier == "[ALL]") {
+        if (chosen.matches(jf[i])) {
             success("Removed item '" + std::string(jf[i]["identifier"]) + "' from the database.");
         } else {
             n.push_back(jf[i]);
@@ -436,36 +3365,105 @@ void erase(parameter& parent, const std::string _) {
 }
 
 void item(parameter& parent, const std::string identifier) {
-    // all?
-    if (identifier != "[ALL]") {
-        // read json
-        nm::json jf = read(parent, getOut(parent));
-
-        // ensure that the item exists
-        bool found = false;
-        for (const auto& j : jf) {
-            if (j["identifier"] == identifier) {
-                found = true;
-            }
+    selection chosen(parent, identifier);
+    std::string path = chosen.what() != selection::all ? getOut(parent) : "";
+    if (chosen.what() == selection::one) {
+        // ensure that the item exists, through the index or else reading no further than it
+        lookup l = indexed(path, chosen.identifier(), [](json&) {});
+        bool found = l == lookup::found;
+        if (l == lookup::unindexed) {
+            stream(parent, path, [&](const json& j) {
+                timer t(phase::scan);
+                found = j["identifier"] == chosen.identifier();
+                return !found;
+            });
         }
 
         // if not found, ararrghH!!!!
         if (!found) {
             fatal(parent.prettify() + ITEM_EXISTS_ERROR);
         }
+    } else if (chosen.what() == selection::listed) {
+        // every one of them must exist, which takes one pass at most
+        std::unordered_set<std::string> missing = chosen.identifiers();
+        stream(parent, path, [&](const json& j) {
+            timer t(phase::scan);
+            const json& id = j["identifier"];
+            if (id.is_string()) {
+                missing.erase(id.get_ref<const std::string&>());
+            }
+            return !missing.empty();
+        });
+        if (!missing.empty()) {
+            for (const auto& id : missing) {
+                warning("Item '" + id + "' does not exist in the database.");
+            }
+            fatal(parent.prettify() + ITEMS_EXIST_ERROR);
+        }
+    } else if (chosen.what() == selection::pattern) {
+        // at least one must match
+        bool found = false;
+        stream(parent, path, [&](const json& j) {
+            timer t(phase::scan);
+            found = chosen.matches(j);
+            return !found;
+        });
+        if (!found) {
+            fatal(parent.prettify() + NO_ITEMS_MATCH_ERROR);
+        }
     }
 
-    parent.result = identifier;
+    config.item = identifier;
+}
+
+void key(parameter&, const std::string key_name) {
+    config.keys = split(key_name);
 }
 
-void key(parameter& parent, const std::string key_name) {
-    parent.result = key_name;
+// assigns each key its value, converted to its type, on item 'j'.
+void assign(parameter& parent, json& j, const std::vector<std::string>& keys, std::vector<std::string> fvals, const std::vector<std::string>& otypes) {
+    for (int k = 0; k < keys.size(); k++) {
+        std::string key = keys[k];
+        std::string fval = fvals[k];
+        std::string otype = otypes[k];
+        
+        // attempt at conversion
+        if (otype == "null") {
+            j[key] = {};
+        } else if (otype == "string") {
+            j[key] = fval;
+        } else if (otype == "int" || otype == "integer") {
+            int val;
+            try {
+                val = std::stoi(fval);
+            } catch (const std::exception&) {
+                fatal(parent.prettify() + TYPE_CONVERSION_ERROR);
+            }
+            j[key] = val;
+        } else if (otype == "float" || otype == "decimal") {
+            double val;
+            try {
+                val = std::stod(fval);
+            } catch (const std::exception&) {
+                fatal(parent.prettify() + TYPE_CONVERSION_ERROR);
+            }
+            j[key] = val;
+        } else if (otype == "boolean" || otype == "bool") {
+            j[key] = fval[0] == 't' ? true : false;
+            fval = j[key] ? "true" : "false";
+        } else {
+            // impossible, but you never know
+            fatal(parent.prettify() + INVALID_TYPE_ERROR);
+        }
+        success("Value of key '" + key + "' has been assigned the value '" + fval + "' (of type '" + otype + "') for item '" + std::string(j["identifier"]) + "'.");
+    }
 }
 
 void value(parameter& parent, const std::string new_value) {
     std::vector<std::string> keys = getKeys(parent);
-    std::vector<std::string> fvals = getVals(new_value);
-    std::vector<std::string> otypes = getTypes(parent);
+    config.values = split(new_value);
+    std::vector<std::string> fvals = config.values;
+    std::vector<std::string> otypes = getTypes();
     // check for inconsistency
     if (keys.size() != fvals.size()) {
         fatal(parent.prettify() + KEY_VAL_MATCH_ERROR);
@@ -480,55 +3478,36 @@ void value(parameter& parent, const std::string new_value) {
     }
 
     std::string path = getOut(parent);
-    std::string identifier = getItem(parent);
+    lock guard(path); // held from reading through to writing
+    selection chosen(parent, getItem(parent));
+
+    // a padded database has its item patched where it lies, if the index knows where that is
+    // and no one is reading it; otherwise the item is carried over into a new generation
+    if (chosen.what() == selection::one && config.slack == SIZE_MAX) {
+        // laid out while the item is in hand, but written once the lookup has let go of the database
+        entry at;
+        std::string text;
+        indexed(path, chosen.identifier(), [&](json& j) {
+            if (at.header.slack > 0) {
+                assign(parent, j, keys, fvals, otypes);
+                text = itemText(j);
+            }
+        }, &at);
+        if (text != "" && patch(path, text, at)) {
+            return;
+        }
+    }
 
     // read the json
-    nm::json jf = read(parent, path);
+    json jf = read(parent, path);
+    timer t(phase::scan);
 
     // find the element and replace the key
     for (auto& j : jf) {
-        if (j["identifier"] == identifier || identifier == "[ALL]") {
-            bool out = false; // break out
-            for (int k = 0; k < keys.size(); k++) {
-                std::string key = keys[k];
-                std::string fval = fvals[k];
-                std::string otype = otypes[k];
-                
-                // attempt at conversion
-                if (otype == "null") {
-                    j[key] = {};
-                } else if (otype == "string") {
-                    j[key] = fval;
-                } else if (otype == "int" || otype == "integer") {
-                    int val;
-                    try {
-                        val = std::stoi(fval);
-                    } catch (std::exception) {
-                        fatal(parent.prettify() + TYPE_CONVERSION_ERROR);
-                    }
-                    j[key] = val;
-                } else if (otype == "float" || otype == "decimal") {
-                    double val;
-                    try {
-                        val = std::stod(fval);
-                    } catch (std::exception) {
-                        fatal(parent.prettify() + TYPE_CONVERSION_ERROR);
-                    }
-                    j[key] = val;
-                } else if (otype == "boolean" || otype == "bool") {
-                    j[key] = fval[0] == 't' ? true : false;
-                    fval = j[key] ? "true" : "false";
-                } else {
-                    // impossible, but you never know
-                    fatal(parent.prettify() + INVALID_TYPE_ERROR);
-                }
-                success("Value of key '" + key + "' has been assigned the value '" + fval + "' (of type '" + otype + "') for item '" + std::string(j["identifier"]) + "'.");
-                // basically only say once for [ALL]
-                if (identifier != "[ALL]") {
-                    out = true;
-                }
-            }
-            if (out) {
+        if (chosen.matches(j)) {
+            assign(parent, j, keys, fvals, otypes);
+            // identifiers are unique, so one is all there is
+            if (chosen.what() == selection::one) {
                 break;
             }
         }
@@ -541,7 +3520,8 @@ void value(parameter& parent, const std::string new_value) {
 void pop(parameter& parent, const std::string _) {
     // get stuffs
     std::string path = getOut(parent);
-    std::string identifier = getItem(parent);
+    lock guard(path); // held from reading through to writing
+    selection chosen(parent, getItem(parent));
 
     std::vector<std::string> keys = getKeys(parent);
 
@@ -552,32 +3532,30 @@ void pop(parameter& parent, const std::string _) {
         }
     }
 
-    // read json
-    nm::json jf = read(parent, path);
-    
+    // read into columns, and look the keys up once
+    store db = load(parent, path);
+    timer t(phase::scan);
+    std::vector<std::uint32_t> popping;
+    for (auto& k : keys) {
+        popping.push_back(db.keys.find(k));
+    }
+    chosen.bind(db);
+
     // pop value
-    nm::json jfinal;
     bool overall = false;
-    for (auto& j : jf) {
-        auto clone = j;
-        if (j["identifier"] == identifier || identifier == "[ALL]") {
-            for (auto& k : keys) {
-                bool changed = false;
-                for (auto& i : j.items()) {
-                    if (i.key() == k) {
-                        changed = true;
-                        overall = true;
-                        clone.erase(k);
-                    }
-                }
-                if (!changed) {
-                    warning("Key '" + k + "' not present in '" + std::string(j["identifier"]) + "'.");
+    for (std::size_t id = 0; id < db.size(); id++) {
+        if (chosen.matches(db, id)) {
+            for (std::size_t at = 0; at < keys.size(); at++) {
+                std::uint32_t key = popping[at];
+                if (key == symbols::none || !db.columns[key].present.test(id)) {
+                    warning("Key '" + keys[at] + "' not present in '" + std::string(db.identifier(id)) + "'.");
                 } else {
-                    success("Key '" + k + "' removed from item '" + std::string(j["identifier"]) + "'.");
+                    db.columns[key].present.reset(id);
+                    overall = true;
+                    success("Key '" + keys[at] + "' removed from item '" + std::string(db.identifier(id)) + "'.");
                 }
             }
         }
-        jfinal.push_back(clone);
     }
 
     if (!overall) {
@@ -585,121 +3563,456 @@ void pop(parameter& parent, const std::string _) {
     }
 
     // write json
+    json jfinal = db.array();
     write(parent, path, jfinal);
 }
 
 void type(parameter& parent, const std::string object_type) {
     // might as well get it over with
-    parent.result = object_type;
+    config.types = split(object_type);
+}
+
+// writes a single item to the console in the readable format.
+void render(const json& j) {
+    timer t(phase::render);
+    paint<style::grey>(console, "╔═: ");
+    paint<style::yellow, style::bold>(console, j["identifier"].get_ref<const std::string&>()) << '\n';
+    int i = 0; // tracker
+    for (auto& kav : j.items()) {
+        i++;
+        if (kav.key() == "identifier") {
+            continue;
+        }
+        if (i == j.size()) {
+            paint<style::grey>(console, "╚ ");
+        } else {
+            paint<style::grey>(console, "╠ ");
+        }
+        paint<style::turqoise, style::italic>(console, kav.key()) << " : ";
+        paint<style::yellow>(console, kav.value()) << '\n';
+    }
+    if (i < 2) {
+        paint<style::grey>(console, "╚ ");
+        paint<style::lightred>(console, "N/A") << '\n';
+    }
+}
+
+// writes item 'id' of 'db' just as render writes it, straight from the columns.
+void render(const store& db, std::size_t id) {
+    timer t(phase::render);
+    arena::heap unarena; // escaped strings are dumped through a json, freed again straight away
+    paint<style::grey>(console, "╔═: ");
+    paint<style::yellow, style::bold>(console, db.identifier(id)) << '\n';
+    // keys are shown in order of their names, and the identifier has its place among them
+    std::size_t size = 1;
+    for (std::uint32_t key : db.order) {
+        size += db.columns[key].present.test(id);
+    }
+    std::size_t i = 0;
+    bool identified = false;
+    std::string scratch, value;
+    for (std::uint32_t key : db.order) {
+        const column& col = db.columns[key];
+        if (!col.present.test(id)) {
+            continue;
+        }
+        const std::string& name = db.keys.name(key);
+        if (!identified && name > "identifier") {
+            identified = true;
+            i++;
+        }
+        i++;
+        if (i == size) {
+            paint<style::grey>(console, "╚ ");
+        } else {
+            paint<style::grey>(console, "╠ ");
+        }
+        paint<style::turqoise, style::italic>(console, name) << " : ";
+        if (col.cells[id].type == json::value_t::string) {
+            value.assign(1, '"');
+            value.append(col.dumped(id, scratch));
+            value.push_back('"');
+            paint<style::yellow>(console, value) << '\n';
+        } else {
+            paint<style::yellow>(console, col.view(id)) << '\n';
+        }
+    }
+    if (size < 2) {
+        paint<style::grey>(console, "╚ ");
+        paint<style::lightred>(console, "N/A") << '\n';
+    }
+}
+
+// shows the items of 'db' as readable does, without turning any of them back into JSON.
+void showReadable(parameter& parent, const store& db, selection& chosen) {
+    bool one = chosen.what() == selection::one;
+    chosen.bind(db);
+
+    // a single item is found by its hash
+    if (one && config.cursor == "" && config.offset == 0 && config.limit > 0) {
+        std::size_t id = db.find(chosen.identifier());
+        if (id < db.size()) {
+            render(db, id);
+        }
+        return;
+    }
+
+    ordering by(parent, config.sort, config.types);
+    if (by) {
+        std::vector<std::size_t> first;
+        {
+            timer t(phase::scan);
+            by.bind(db);
+            ranking best(by, keeping());
+            for (std::size_t id = 0; id < db.size(); id++) {
+                if (chosen.matches(db, id)) {
+                    best.offer(id, by.of(db, id));
+                }
+            }
+            first = best.positions();
+        }
+        page pg(parent, false);
+        for (std::size_t id : first) {
+            page::verdict v = pg.take(db.identifier(id));
+            if (v == page::full) {
+                break;
+            } else if (v == page::shown) {
+                render(db, id);
+            }
+        }
+        return;
+    }
+
+    page pg(parent);
+    std::size_t matched = 0;
+    for (std::size_t id = 0; id < db.size(); id++) {
+        if (!pg.next(parent, db.identifier(id)) || !chosen.matches(db, id)) {
+            continue;
+        }
+        if (matched++ == config.top) {
+            break;
+        }
+        page::verdict v = pg.take(db.identifier(id));
+        if (v == page::full) {
+            break;
+        } else if (v == page::shown) {
+            render(db, id);
+        }
+        // identifiers are unique, so one is all there is
+        if (one) {
+            break;
+        }
+    }
 }
 
 void readable(parameter& parent, const std::string _identifier) {
     // fetch items and all
     std::string path = getOut(parent);
-    std::string identifier;
-    if (_identifier != ABSENT) {
-        identifier = _identifier;
-    } else {
-        identifier = getItem(parent, false);
+    // if no identifier, every item is shown
+    selection chosen(parent, _identifier != ABSENT ? _identifier : getItem(parent, false));
+    bool one = chosen.what() == selection::one;
+
+    // from the database's snapshot, if it has one as it is now, nothing needs parsing
+    store db;
+    if (mapped(path, db)) {
+        showReadable(parent, db, chosen);
+        return;
     }
 
-    // if no identifier
-    if (identifier == "" || identifier == "[ALL]") {
-        for (const auto& j : read(parent, path)) {
-            readable(parent, j["identifier"]);
+    // a single item straight from the index, if there is one and no paging is asked for
+    if (one && config.cursor == "" && config.offset == 0 && config.limit > 0) {
+        switch (indexed(path, chosen.identifier(), [](const json& j) { render(j); })) {
+            case lookup::found:
+                return;
+            case lookup::absent:
+                return;
+            case lookup::unindexed:
+                break;
         }
     }
 
-    // read all of contents
-    std::string out; // string to be pushed to console
-    nm::json jf = read(parent, path);
-    for (const auto& j : jf) {
-        if (j["identifier"] == identifier || identifier == "[ALL]") {
-            out += paint("╔═: ", "grey") + paint(j["identifier"].get<std::string>(), {"yellow", "bold"}) + "\n";
-            int i = 0; // tracker
-            for (auto& kav : j.items()) {
-                i++;
-                if (kav.key() == "identifier") {
+    // only the items that make it onto the page are parsed
+    outline o = scan(parent, path);
+    indexHeader header;
+    if (!batch.covers(path) && !(readIndexHeader(path, header) && header.stamp == o.stamp)) {
+        std::vector<indexRecord> records;
+        for (auto& item : o.items) {
+            records.push_back({hash64(item.identifier), item.begin, item.end});
+        }
+        writeIndex(path, records, slackOf(path), o.stamp);
+    }
+
+    // sorted, every match has to be parsed and ranked, but only as many as are shown are kept
+    ordering by(parent, config.sort, config.types);
+    if (by) {
+        try {
+            ranking best(by, keeping());
+            for (std::size_t at = 0; at < o.items.size(); at++) {
+                if (chosen.what() != selection::filtered && !chosen.matches(o.items[at].identifier)) {
                     continue;
                 }
-                if (i == j.size()) {
-                    out += paint("╚ ", "grey");
-                } else {
-                    out += paint("╠ ", "grey");
-                }
-                out += paint(kav.key(), {"turqoise", "italic"}) + " : ";
-                out += paint(kav.value(), "yellow") + "\n";
+                o.parse(at, [&](const json& item) {
+                    if (chosen.matches(item)) {
+                        best.offer(at, by.of(item));
+                    }
+                });
             }
-            if (i < 2) {
-                out += paint("╚ ", "grey") + paint("N/A", "lightred") + "\n";
+            page pg(parent, false);
+            for (std::size_t at : best.positions()) {
+                page::verdict v = pg.take(o.items[at].identifier);
+                if (v == page::full) {
+                    break;
+                } else if (v == page::shown) {
+                    o.parse(at, [](const json& item) { render(item); });
+                }
             }
+        } catch (const json::exception&) { // catch json errors
+            fatal(parent.prettify() + JSON_ERROR);
         }
+        return;
     }
 
-    // out to console
-    std::cout << out;
+    page pg(parent);
+    std::size_t matched = 0;
+    // puts a matching item on the page, parsing it only if it is shown and not parsed already.
+    // returns false once no more are to be shown.
+    auto show = [&](std::size_t at, const json * item) {
+        if (matched++ == config.top) {
+            return false;
+        }
+        page::verdict v = pg.take(o.items[at].identifier);
+        if (v == page::shown) {
+            if (item != nullptr) {
+                render(*item);
+            } else {
+                o.parse(at, [](const json& item) { render(item); });
+            }
+        }
+        return v != page::full;
+    };
+    for (std::size_t at = 0; at < o.items.size(); at++) {
+        const std::string& id = o.items[at].identifier;
+        if (!pg.next(parent, id)) {
+            continue;
+        }
+        bool more = true;
+        try {
+            // a predicate has to look inside the item, so it is parsed either way
+            if (chosen.what() == selection::filtered) {
+                o.parse(at, [&](const json& item) {
+                    if (chosen.matches(item)) {
+                        more = show(at, &item);
+                    }
+                });
+            } else if (chosen.matches(id)) {
+                more = show(at, nullptr);
+            } else {
+                continue;
+            }
+        } catch (const json::exception&) { // catch json errors
+            fatal(parent.prettify() + JSON_ERROR);
+        }
+        // identifiers are unique, so one is all there is
+        if (!more || one) {
+            break;
+        }
+    }
 }
 
 void verbose(parameter& parent, const std::string _) {
-    parent.passed = "verbose";
+    config.verbose = true;
+}
+
+// match offsets, reused between items so that searching does not allocate per match.
+struct hits {
+    std::vector<std::size_t> id, key, val;
+};
+
+// writes the item's identifier, and every key and value of it that contains 'term', to the console.
+void showMatches(const store& db, std::size_t id, const std::string& term, hits& at) {
+    timer t(phase::render);
+    std::string scratch;
+    paint<style::grey>(console, "⮩ ");
+    matches(db.identifier(id), term, at.id);
+    highlight<style::yellow, style::bold>(console, db.identifier(id), at.id, term.size()) << '\n';
+    for (std::uint32_t key : db.order) {
+        const std::string& name = db.keys.name(key);
+        const column& col = db.columns[key];
+        if (!col.present.test(id)) {
+            continue;
+        }
+        std::string_view val = col.dumped(id, scratch);
+        bool inKey = matches(name, term, at.key);
+        bool inVal = matches(val, term, at.val);
+        if (inKey || inVal) {
+            paint<style::grey>(console, " ⬥ ");
+            // feed to console
+            highlight<style::turqoise, style::italic>(console, name, at.key, term.size()) << " : ";
+            paint<style::yellow>(console, '"');
+            highlight<style::yellow>(console, val, at.val, term.size());
+            paint<style::yellow>(console, '"') << '\n';
+        }
+    }
 }
 
 void search(parameter& parent, const std::string term) {
     // get values
     std::string path = getOut(parent);
+    store db = load(parent, path);
 
-    // read json
-    nm::json jf = read(parent, path);
-
-    // iterate
-    std::string out = "";
-    int i = 0;
-    for (const auto& j : jf) {
-        i += 1;
-        // loop through items
-        bool saidIdentifier = false;
-        std::string idstr = paint("⮩ ", "grey") + highlight(j["identifier"], term, {"yellow", "bold"}) + "\n";
-        // add identifier beforehand if contains term
-        if (std::string(j["identifier"]).find(term) != std::string::npos) {
-            out += idstr;
-            saidIdentifier = true;
-        }
-        for (auto& it : j.items()) {
-            if (it.key() == "identifier") {
+    // find every matching item a column at a time, identifiers first
+    bitmap hit;
+    if (!term.empty()) {
+        timer t(phase::scan);
+        for (std::size_t id = 0; id < db.size(); id++) {
+            if (db.identifier(id).find(term) != std::string_view::npos) {
+                hit.set(id);
+            }
+        }
+        for (std::uint32_t key = 0; key < db.keys.size(); key++) {
+            const column& col = db.columns[key];
+            // every item with a matching key matches
+            if (db.keys.name(key).find(term) != std::string::npos) {
+                hit.merge(col.present);
                 continue;
-            } else {
-                // get true value of value to string
-                std::ostringstream oss;
-                oss << it.value();
-                std::string val = oss.str();
-                // if string, remove quotations
-                if (it.value().is_string()) {
-                    val = val.replace(0, 1, "");
-                    val = val.replace(val.size()-1, val.size(), "");
-                }
-                // if exists
-                if (it.key().find(term) != std::string::npos || val.find(term) != std::string::npos) {
-                    if (!saidIdentifier) { // add name to out if not already
-                        out += idstr;
-                        saidIdentifier = true;
-                    }
-                    out += paint(" ⬥ ", "grey");
-                    // feed to out
-                    out += highlight(it.key(), term, {"turqoise", "italic"}) + " : ";
-                    std::string qt = paint("\"", "yellow");
-                    out += qt + highlight(val, term, {"yellow"}) + qt + "\n";
+            }
+            std::string scratch;
+            col.present.each([&](std::size_t id) {
+                if (!hit.test(id) && col.dumped(id, scratch).find(term) != std::string_view::npos) {
+                    hit.set(id);
                 }
+            });
+        }
+    }
+
+    // then show them in order, stopping as soon as the page is full
+    bool found = false;
+    hits at;
+    ordering by(parent, config.sort, config.types);
+    if (by) {
+        // ranked straight from the columns, keeping only as many as are shown
+        std::vector<std::size_t> first;
+        {
+            timer t(phase::scan);
+            by.bind(db);
+            ranking best(by, keeping());
+            hit.each([&](std::size_t id) {
+                best.offer(id, by.of(db, id));
+            });
+            first = best.positions();
+        }
+        found = hit.count() > 0;
+        page pg(parent, false);
+        for (std::size_t id : first) {
+            page::verdict v = pg.take(db.identifier(id));
+            if (v == page::full) {
+                break;
+            } else if (v == page::shown) {
+                showMatches(db, id, term, at);
+            }
+        }
+    } else {
+        page pg(parent);
+        std::size_t matched = 0;
+        for (std::size_t id = 0; id < db.size(); id++) {
+            if (!pg.next(parent, db.identifier(id)) || !hit.test(id)) {
+                continue;
+            }
+            found = true;
+            if (matched++ == config.top) {
+                break;
+            }
+            page::verdict v = pg.take(db.identifier(id));
+            if (v == page::full) {
+                break;
+            } else if (v == page::shown) {
+                showMatches(db, id, term, at);
             }
         }
     }
 
     // if nothing
-    if (out == "") {
+    if (!found) {
         fatal(parent.prettify() + NO_INSTANCE_ERROR);
     }
+}
 
-    // feed to console
-    std::cout << out;
+void agg(parameter& parent, const std::string spec) {
+    std::string path = getOut(parent);
+    aggregation plan(parent, spec);
+    selection chosen(parent, getItem(parent, false));
+    outline o = scan(parent, path);
+
+    // the items are split into one shard per thread, each parsed and totalled into groups of its own,
+    // which are folded together once every shard is done. nothing but the totals is ever kept.
+    unsigned threads = getThreads();
+    std::vector<aggregation::groups> shards(threads);
+    std::atomic<bool> malformed {false};
+    {
+        timer t(phase::parse);
+        arena::heap unarena; // workers start on the heap already; this keeps the calling thread off the arena too
+        bool looks = plan.looks() || chosen.what() == selection::filtered;
+        const json none = json::object();
+        pool workers(threads);
+        if (!workers.good()) {
+            fatal(parent.prettify() + THREAD_START_ERROR);
+        }
+        workers.run(threads, [&](std::size_t first, std::size_t last) {
+            for (std::size_t shard = first; shard < last; shard++) {
+                std::size_t begin = o.items.size() * shard / threads, end = o.items.size() * (shard + 1) / threads;
+                for (std::size_t at = begin; at < end; at++) {
+                    const span& item = o.items[at];
+                    if (chosen.what() != selection::filtered && !chosen.matches(item.identifier)) {
+                        continue;
+                    }
+                    if (!looks) { // only counted
+                        plan.add(shards[shard], none);
+                        continue;
+                    }
+                    try {
+                        json j = json::parse(o.text.data() + item.begin, o.text.data() + item.end);
+                        if (chosen.matches(j)) {
+                            plan.add(shards[shard], j);
+                        }
+                    } catch (const json::exception&) {
+                        malformed = true;
+                    }
+                }
+            }
+        });
+    }
+    if (malformed) {
+        fatal(parent.prettify() + JSON_ERROR);
+    }
+
+    // fold the shards together, and show the groups in order
+    aggregation::groups& total = shards[0];
+    for (unsigned shard = 1; shard < threads; shard++) {
+        plan.merge(total, shards[shard]);
+    }
+    if (plan.by.empty() && total.empty()) {
+        total[""].resize(plan.aggregates.size());
+    }
+    std::vector<std::pair<std::string, std::vector<aggregation::tally>>> groups(total.begin(), total.end());
+    std::sort(groups.begin(), groups.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    timer t(phase::render);
+    for (const auto& g : groups) {
+        paint<style::grey>(console, "╔═: ");
+        if (plan.by.empty()) {
+            paint<style::yellow, style::bold>(console, "all items") << '\n';
+        } else if (g.first.empty()) {
+            paint<style::lightred>(console, "no " + plan.by) << '\n';
+        } else {
+            paint<style::yellow, style::bold>(console, plan.by + " = " + g.first) << '\n';
+        }
+        for (std::size_t i = 0; i < plan.aggregates.size(); i++) {
+            const auto& a = plan.aggregates[i];
+            paint<style::grey>(console, i + 1 == plan.aggregates.size() ? "╚ " : "╠ ");
+            paint<style::turqoise, style::italic>(console, a.name) << " : ";
+            paint<style::yellow>(console, plan.result(a, g.second[i])) << '\n';
+        }
+    }
 }
 
 void encrypt(parameter& parent, const std::string phrase) {
@@ -756,22 +4069,23 @@ void encrypt(parameter& parent, const std::string phrase) {
     }
 
     // in and out
-    std::fstream fin(path, std::fstream::in);
-    std::fstream fout(ENCRYPT, std::fstream::out);
+    lock out(ENCRYPT);
+    snapshot fin(path);
+    std::string staged = staging(ENCRYPT);
+    std::ofstream fout(staged, std::ios::binary);
 
     // charshift algorithm
-    char i;
-    while (fin >> std::noskipws >> i) {
-        int temp;
-        for (int x = 0; x < phrase.size(); x++) {
-            temp = i + phrase[x];
-        }
-        fout << (char)temp;
-    }
+    // every character of the phrase overwrites the last shift, so only the final one counts
+    charshift(parent, fin.in, fin.size(), phrase.back(), [&](const char * data, std::size_t size) {
+        fout.write(data, size);
+        profile.current.written += size;
+    });
 
     // finished
-    fin.close();
     fout.close();
+    if (!fout || !promote(staged, ENCRYPT)) {
+        fatal(parent.prettify() + WRITE_ERROR);
+    }
 
     // success
     success("Successfully encrypted '" + path + "'.");
@@ -781,30 +4095,30 @@ void decrypt(parameter& parent, const std::string phrase) {
     // get outfile for decrypting
     std::string path = getOut(parent, false, ENCRYPT);
 
-    // in and out
-    std::fstream fin(path, std::fstream::in);
-    std::ostringstream comp;
-
-    // essentially do the opposite of encrypt
-    // shift all bytes left by c as integer for every c in phrase
-    char i;
-    while (fin >> std::noskipws >> i) {
-        int temp;
-        for (int x = 0; x < phrase.size(); x++) {
-            temp = i - phrase[x];
-        }
-        comp << (char)temp;
+    // nothing could have been encrypted with an empty phrase
+    if (phrase.empty()) {
+        fatal(parent.prettify() + PHRASE_TOO_SHORT_ERROR);
     }
 
-    // finished-ish
-    fin.close();
+    // in and out
+    std::string comp;
+    {
+        snapshot fin(path);
+
+        // essentially do the opposite of encrypt
+        // shift all bytes left by the last c in phrase
+        charshift(parent, fin.in, fin.size(), -phrase.back(), [&](const char * data, std::size_t size) {
+            comp.append(data, size);
+        });
+    } // finished-ish
 
     // now attempt to parse
     bool valid = true;
-    nm::json jp;
+    json jp;
     try {
-        jp = nm::json::parse(comp.str());
-    } catch (nm::json_abi_v3_11_2::detail::parse_error) {
+        timer t(phase::parse);
+        jp = json::parse(comp);
+    } catch (const json::parse_error&) {
         valid = false;
     }
     if (jp.is_null() || !valid) {
@@ -812,38 +4126,354 @@ void decrypt(parameter& parent, const std::string phrase) {
     }
 
     // since all went well, write
-    std::fstream fout(DECRYPT, std::fstream::out);
-    fout << comp.str();
+    lock out(DECRYPT);
+    std::string staged = staging(DECRYPT);
+    std::ofstream fout(staged, std::ios::binary);
+    fout.write(comp.data(), comp.size());
+    profile.current.written += comp.size();
     fout.close();
+    if (!fout || !promote(staged, DECRYPT)) {
+        fatal(parent.prettify() + WRITE_ERROR);
+    }
 
     // set outfile to new decrypted
-    setParameterValue("o", DECRYPT);
+    config.outfile = DECRYPT;
 
     // success
     success("Successfully decrypted '" + path + "'.");    
 }
 
+void threads(parameter& parent, const std::string amount) {
+    int n = 0;
+    try {
+        n = std::stoi(amount);
+    } catch (const std::exception&) {}
+    if (n < 1) {
+        fatal(parent.prettify() + INVALID_THREADS_ERROR);
+    } else if ((unsigned)n > MAX_THREADS) {
+        warning(parent.prettify() + TOO_MANY_THREADS_ERROR);
+        n = MAX_THREADS;
+    }
+    config.threads = n;
+}
+
+// parses a whole, non-negative number for l/limit and m/offset.
+std::size_t amount(parameter& parent, const std::string raw) {
+    std::size_t n = 0;
+    auto [end, error] = std::from_chars(raw.data(), raw.data() + raw.size(), n);
+    if (error != std::errc() || end != raw.data() + raw.size()) {
+        fatal(parent.prettify() + INVALID_AMOUNT_ERROR);
+    }
+    return n;
+}
+
+void limit(parameter& parent, const std::string n) {
+    config.limit = amount(parent, n);
+}
+
+void offset(parameter& parent, const std::string n) {
+    config.offset = amount(parent, n);
+}
+
+void cursor(parameter& parent, const std::string token) {
+    config.cursor = token;
+}
+
+void sort(parameter& parent, const std::string key) {
+    config.sort = key;
+}
+
+void top(parameter& parent, const std::string n) {
+    config.top = amount(parent, n);
+}
+
+void slack(parameter& parent, const std::string n) {
+    config.slack = amount(parent, n);
+}
+
+void profiling(parameter& parent, const std::string format) {
+    if (format != ABSENT && format != "table" && format != "json") {
+        fatal(parent.prettify() + INVALID_PROFILE_ERROR);
+    }
+    config.profile = true;
+    config.profileJson = format == "json";
+}
+
 void colourless(parameter& parent, const std::string _) {
-    parent.result = "colourless";
+    config.colourless = true;
     warning("Disabled colours.");
 }
 
 void force(parameter& parent, const std::string _) {
+    config.force = true;
     warning("In force mode.");
-    parent.result = "colourless";
 }
 
 void count(parameter& parent, const std::string _) {
     std::string path = getOut(parent);
-    nm::json jf = read(parent, path);
-    std::cout << paint("There are ", "green") << paint(std::to_string(jf.size()), (jf.size() > 0 ? "magenta" : "lightred")) << paint(" items in the database.", "green") << std::endl;
+    store db = load(parent, path);
+    timer t(phase::render);
+    paint<style::green>(console, "There are ");
+    if (db.size() > 0) {
+        paint<style::magenta>(console, db.size());
+    } else {
+        paint<style::lightred>(console, db.size());
+    }
+    paint<style::green>(console, " items in the database.") << '\n';
+}
+
+void stats(parameter& parent, const std::string _) {
+    std::string path = getOut(parent);
+
+    store db = load(parent, path);
+
+    // a column at a time, the identifiers first
+    std::uintmax_t items = db.size();
+    std::uintmax_t bytes = 0;
+    std::map<std::string, keyStats> keys;
+    {
+        timer t(phase::scan);
+        if (items > 0) {
+            keyStats& k = keys["identifier"];
+            for (std::size_t at = 0; at < db.size(); at++) {
+                std::string_view id = db.identifier(at);
+                // braces, and the identifier's key and value
+                bytes += 2 + dumpedSize("identifier") + 1 + dumpedSize(id);
+                k.add("string", id);
+            }
+        }
+        for (std::uint32_t key : db.order) {
+            const std::string& name = db.keys.name(key);
+            const column& col = db.columns[key];
+            keyStats& k = keys[name];
+            col.present.each([&](std::size_t id) {
+                const column::cell& cell = col.cells[id];
+                std::string_view text = col.view(id);
+                // a comma, the key and the value
+                bytes += 1 + dumpedSize(name) + 1 + (cell.escaped ? dumpedSize(text) : cell.type == json::value_t::string ? text.size() + 2 : text.size());
+                k.add(typeName(cell.type), text);
+            });
+        }
+    }
+
+    // feed to console
+    timer t(phase::render);
+    paint<style::green>(console, "Items: ");
+    paint<style::magenta>(console, items);
+    paint<style::green>(console, ", totalling ");
+    paint<style::magenta>(console, bytes);
+    paint<style::green>(console, " bytes of compact JSON (");
+    paint<style::magenta>(console, items > 0 ? bytes / items : 0);
+    paint<style::green>(console, " per item).") << '\n';
+
+    for (auto& [name, k] : keys) {
+        paint<style::grey>(console, "╔═: ");
+        paint<style::yellow, style::bold>(console, name) << '\n';
+
+        char percent[16];
+        std::snprintf(percent, sizeof(percent), "%.1f%%", 100.0 * k.present / items);
+        paint<style::grey>(console, "╠ ");
+        paint<style::turqoise, style::italic>(console, "present") << " : ";
+        paint<style::yellow>(console, k.present) << " (" << percent << ")\n";
+
+        paint<style::grey>(console, "╠ ");
+        paint<style::turqoise, style::italic>(console, "types") << " : ";
+        bool first = true;
+        for (auto& [type, n] : k.types) {
+            console << (first ? "" : ", ");
+            paint<style::yellow>(console, type) << " × " << n;
+            first = false;
+        }
+        console << '\n';
+
+        paint<style::grey>(console, "╠ ");
+        paint<style::turqoise, style::italic>(console, "distinct") << " : ";
+        paint<style::yellow>(console, "~" + std::to_string((std::uintmax_t)std::llround(k.distinct.estimate()))) << '\n';
+
+        paint<style::grey>(console, "╚ ");
+        paint<style::turqoise, style::italic>(console, "lengths") << " : ";
+        first = true;
+        for (std::size_t b = 0; b < k.lengths.size(); b++) {
+            if (k.lengths[b] == 0) {
+                continue;
+            }
+            console << (first ? "" : ", ");
+            std::string range = b < 2 ? std::to_string(b) : std::to_string(1ull << (b - 1)) + "–" + std::to_string((1ull << b) - 1);
+            paint<style::yellow>(console, range) << " × " << k.lengths[b];
+            first = false;
+        }
+        console << '\n';
+    }
+}
+
+// splits a command line into its words, keeping anything within double quotes together.
+std::vector<std::string> words(const std::string& line) {
+    std::vector<std::string> out;
+    std::string word;
+    bool quoted = false, started = false;
+    for (char c : line) {
+        if (c == '"') {
+            quoted = !quoted;
+            started = true;
+        } else if (!quoted && std::isspace((unsigned char)c)) {
+            if (started) {
+                out.push_back(std::move(word));
+                word.clear();
+                started = false;
+            }
+        } else {
+            word += c;
+            started = true;
+        }
+    }
+    if (started) {
+        out.push_back(std::move(word));
+    }
+    return out;
+}
+
+void transact(parameter& parent, const std::string script) {
+    std::string path = getOut(parent);
+    lock guard(path); // held from the first command through to the commit
+    // every command works on its own copy of the database, so each copy is freed once it is done with
+    arena::heap unarena;
+    std::ifstream file(script);
+    if (!file) {
+        fatal(parent.prettify() + SCRIPT_ERROR);
+        return;
+    }
+
+    // every line is a command line of its own, run against the database in memory. a command that fails
+    // ends kial before anything has been written, so either all of them take effect or none do.
+    settings base = config;
+    batch.path = path;
+    std::string line;
+    int commands = 0;
+    while (std::getline(file, line)) {
+        std::vector<std::string> args = words(line);
+        if (args.empty() || args[0][0] == '#') {
+            continue;
+        }
+        std::vector<const char *> argv = {"kial"};
+        for (const auto& arg : args) {
+            argv.push_back(arg.c_str());
+        }
+        config = base; // nothing carries over from one command to the next
+        int passed = 0;
+        int failures = fatalities;
+        ran r = run(argv.size(), argv.data(), passed, [](parameter& p) {
+            // the database must stay the one the transaction covers, as it was before the transaction
+            const std::string& name = p.names.front();
+            if (name == "o" || name == "e" || name == "d" || name == "T") {
+                fatal(p.prettify() + NOT_IN_TRANSACTION_ERROR);
+                return false;
+            }
+            return true;
+        });
+        if (r == ran::failed || fatalities != failures) {
+            // F/force carries on past a fatal error, but never as far as committing part of a transaction
+            batch = transaction();
+            config = base;
+            config.force = false;
+            fatal(parent.prettify() + TRANSACTION_FAILED_ERROR);
+        }
+        commands++;
+    }
+    config = base;
+
+    // commit everything in one write, made durable before it takes the old database's place
+    profile.begin(parent.prettify());
+    json pending = std::move(batch.pending);
+    bool dirty = batch.dirty;
+    batch = transaction();
+    if (dirty) {
+        write(parent, path, pending, true);
+    }
+    success("Committed " + std::to_string(commands) + " command(s) to '" + path + "'.");
 }
 
 /*/////////*
 //  MAIN  //
 */////////*/
 
+// parses a command line and runs every parameter passed on it, in the order they are declared.
+// 'passed' counts those given a value. 'admit', if any, is asked about every parameter passed before any of them runs.
+ran run(int argc, const char * const argv[], int& passed, std::function<bool(parameter&)> admit) {
+    // add arguments via argh
+    argh::parser parser;
+    for (int at = 0; at < mainParameters.size(); at++) {
+        for (const auto& name : mainParameters[at].names) {
+            parser.add_param(name);
+        }
+    }
+
+    // parse for arguments
+    parser.parse(argc, argv);
+
+    // resolve every passed name to its parameter in one go
+    std::vector<std::string> values(mainParameters.size(), ABSENT);
+    std::vector<bool> flags(mainParameters.size(), false);
+    for (const auto& arg : parser.params()) {
+        int at = parameterNames.find(arg.first);
+        if (at != -1 && values[at] == ABSENT) {
+            values[at] = arg.second;
+            passed += 1;
+        }
+    }
+    // if the parameter can also be a flag, check for that
+    for (const auto& fl : parser.flags()) {
+        int at = parameterNames.find(fl);
+        if (at != -1) {
+            flags[at] = true;
+        }
+    }
+
+    // every parameter passed is admitted before any runs, as they run in declaration order, not the order given
+    if (admit) {
+        for (int at = 0; at < mainParameters.size(); at++) {
+            if ((flags[at] || values[at] != ABSENT) && !admit(mainParameters[at])) {
+                return ran::failed;
+            }
+        }
+    }
+
+    // loop through args and assign end values
+    for (int at = 0; at < mainParameters.size(); at++) {
+        parameter& param = mainParameters[at];
+        const std::string& value = values[at];
+        bool flag = flags[at];
+
+        // if no value, but requires, throw
+        if (flag && param.passedRequired) {
+            fatal("Parameter '" + param.prettify("'/'") + "' missing argument(s).");
+            return ran::failed;
+        }
+
+        // check for collides
+        if (flag && value != ABSENT) {
+            fatal("Parameter '" + param.prettify("'/'") + "' passed twice.");
+            return ran::failed;
+        } else if (!flag && value == ABSENT) {
+            //std::cout << param.prettify() << " <- NOT PASSED" << std::endl;
+            continue; // if not passed
+        }
+        //std::cout << param.prettify() << " <- YES PASSED : " << ((value == ABSENT) ? "N/A" : value) << std::endl;
+
+        // add to passed
+        profile.begin(param.prettify());
+        param.execute(param, value);
+        profile.end();
+        if (param.blockingFunc) {
+            return ran::blocked;
+        }
+    }
+    return ran::through;
+}
+
 int main(int argc, char ** argv) {
+    // everything the database allocates, freed in one go when kial is done
+    arena::monotonic memory;
+
     // all parameters
     // organised in such a manner that, during iteration, parameters will work no matter the order
     mainParameters = {
@@ -852,6 +4482,10 @@ int main(int argc, char ** argv) {
         "Enables warning errors.",
         "", verbose, false, false)),
 
+        (parameter({"P", "profile"},
+        "Times each parameter executed and the phases within it (parse, scan, render, serialize, crypt, and wait for locks held by other kial processes), along with bytes read and written, items and peak memory. Reported to stderr as a 'table' (default) or as 'json'.",
+        "format", profiling, false, false)),
+
         (parameter({"F", "force"},
         "Forces the program to run despite fatal errors. Use with caution.",
         "", force, false, false)),
@@ -860,6 +4494,38 @@ int main(int argc, char ** argv) {
         "Disables colours.",
         "", colourless, false, false)),
 
+        (parameter({"j", "threads"},
+        "Sets the number of threads used by e/encrypt, d/decrypt and A/agg. Defaults to the number of cores.",
+        "amount", threads, true, false)),
+
+        (parameter({"l", "limit"},
+        "Shows at most this many items with r/readable and s/search, printing a u/cursor for the next page if more follow.",
+        "amount", limit, true, false)),
+
+        (parameter({"m", "offset"},
+        "Skips this many matching items before r/readable and s/search start showing them.",
+        "amount", offset, true, false)),
+
+        (parameter({"u", "cursor"},
+        "Resumes r/readable or s/search from the cursor printed at the end of the previous page.",
+        "cursor", cursor, true, false)),
+
+        (parameter({"O", "sort"},
+        "Shows the items from r/readable and s/search ordered by the key provided, ascending or, with ':desc' after it, descending. Values are compared as the first t/type if one is given, and otherwise by their JSON types; items without the key come last.",
+        "key[:desc]", sort, true, false)),
+
+        (parameter({"n", "top"},
+        "Keeps only the first this many items of r/readable and s/search, in O/sort order if one is given. Only as many items as are kept are ever held while sorting.",
+        "amount", top, true, false)),
+
+        (parameter({"t", "type"},
+        "Specifies the types of each of the values provided. Can be 'string', 'int'/'integer', 'float'/'decimal' or 'null'. Seperated by commas. The first also sets how O/sort compares values.",
+        "type,type,...", type, true, false)),
+
+        (parameter({"L", "slack"},
+        "Pads every item with this many bytes when the database is written, so that v/value can later change a single item in place instead of rewriting the file. Remembered in the database's index; 0 turns it off.",
+        "bytes", slack, true, false)),
+
         (parameter({"C", "count"},
         "Returns the number of elements in the database.",
         "", count, false, true)),
@@ -880,12 +4546,20 @@ int main(int argc, char ** argv) {
         "Encrypts the outfile with the phrase provided - dumps to '" + ENCRYPT + "'.",
         "phrase", encrypt, true, true)),
 
+        (parameter({"T", "transaction"},
+        "Runs the kial command lines in the file provided, one per line, as a single transaction on the o/outfile: each sees what the ones before it did, and the database is written out once, and flushed to disk, when all are done. If any fails, none take effect.",
+        "path", transact, true, true)),
+
+        (parameter({"S", "stats"},
+        "Summarises the database in one pass: per key, how many items have it, its types, roughly how many distinct values it holds and a histogram of value lengths.",
+        "", stats, false, true)),
+
         (parameter({"s", "search"}, 
         "Searches through the database for the provided term. Prints matching to the console.",
         "term", search, true, true)),
 
         (parameter({"@", "item"},
-        "Specifies the item to be used with the !/erase, k/key and r/readable parameters.",
+        "Specifies the item to be used with the !/erase, k/key and r/readable parameters. Several can be given separated by commas, as '@' and a file with one per line, as a glob like 'user-*', or as 'where' and a condition on their values like 'status==\"stale\" && age>30', combined with &&, ||, ! and brackets.",
         "name/identifier", item, true, false)),
         
         (parameter({"+", "add"},
@@ -900,9 +4574,9 @@ int main(int argc, char ** argv) {
         "Reads the entirety of a item's contents in a readable format. If no item is specified with @/item, all items in the database will be displayed neatly.",
         "", readable, false, true)),
 
-        (parameter({"t", "type"},
-        "Specifies the types of each of the values provided. Can be 'string', 'int'/'integer', 'float'/'decimal' or 'null'. Seperated by commas.",
-        "type,type,...", type, true, false)),
+        (parameter({"A", "agg"},
+        "Works out aggregates over the items in one streaming pass, split across j/threads: 'count', and 'count', 'sum', 'avg', 'min' or 'max' of a key, separated by commas and optionally grouped with 'by key', like 'count, sum(price) by category'. Only numbers are summed, averaged and compared. Acts on the @/item selection if one is given.",
+        "aggregates", agg, true, true)),
 
         (parameter({"k", "key"},
         "Specifies the keys to be modified on the item. Seperated by commas.",
@@ -917,73 +4591,24 @@ int main(int argc, char ** argv) {
         "value,value,...", value, true, false)),
 
     };
-
-    // add arguments via argh
-    argh::parser parser;
-    for (const auto& param : mainParameters) {
-        for (const auto& name : param.names) {
-            parser.add_param(name);
-        }
+    if (!parameterNames.build(mainParameters)) {
+        return fatal(PARAMETER_NAMES_ERROR);
     }
 
-    // parse for arguments
-    parser.parse(argc, argv);
-
-    // loop through args and assign end values
+    // parse for arguments, and run them
     int i = 0;
-    for (auto& param : mainParameters) {
-        // if the parameter has been passed
-        std::string value = ABSENT;
-        for (const auto& arg : parser.params()) {
-            if (value != ABSENT) {
-                break;
-            }
-            for (const auto& name : param.names) {
-                if (arg.first == name) {
-                    value = arg.second;
-                    i += 1;
-                    break;
-                }
-            }
-        }
-
-        // if the parameter can also be a flag, check for that
-        bool flag = false;
-        for (const auto& fl : parser.flags()) {
-            if (flag) {
-                break;
-            }
-            for (const auto& name : param.names) {
-                if (fl == name) {
-                    flag = true;
-                    break;
-                }
-            }
-        }
-
-        // if no value, but requires, throw
-        if (flag && param.passedRequired) {
-            return fatal("Parameter '" + param.prettify("'/'") + "' missing argument(s).");
-        }
-
-        // check for collides
-        if (flag && value != ABSENT) {
-            return fatal("Parameter '" + param.prettify("'/'") + "' passed twice.");
-        } else if (!flag && value == ABSENT) {
-            //std::cout << param.prettify() << " <- NOT PASSED" << std::endl;
-            continue; // if not passed
-        }
-        //std::cout << param.prettify() << " <- YES PASSED : " << ((value == ABSENT) ? "N/A" : value) << std::endl;
-
-        // add to passed
-        param.execute(param, value);
-        if (param.blockingFunc) {
+    switch (run(argc, argv, i)) {
+        case ran::failed:
+            return 1;
+        case ran::blocked:
+            profile.report();
             return 0;
-        } else {
-            continue;
-        }
+        case ran::through:
+            break;
     }
 
+    profile.report();
+
     // if no parameters provided, return error
     if (i == 0) {
         return fatal("No parameters provided.");